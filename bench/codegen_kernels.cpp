@@ -0,0 +1,131 @@
+#include "codegen_kernels.h"
+
+using namespace frogs;
+
+extern "C" {
+
+void unit_add(Distance* out, const Distance* a, const Distance* b, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = a[i] + b[i];
+}
+
+void raw_add(double* out, const double* a, const double* b, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = a[i] + b[i];
+}
+
+void unit_addf(DistanceF* out, const DistanceF* a, const DistanceF* b, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = a[i] + b[i];
+}
+
+void raw_addf(float* out, const float* a, const float* b, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = a[i] + b[i];
+}
+
+void unit_addns(TimeNs* out, const TimeNs* a, const TimeNs* b, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = a[i] + b[i];
+}
+
+void raw_addns(std::int64_t* out, const std::int64_t* a, const std::int64_t* b, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = a[i] + b[i];
+}
+
+std::size_t unit_before(const TimeNs* a, TimeNs t, std::size_t n)
+{
+    std::size_t count = 0;
+    for (std::size_t i = 0 ; i < n ; i++)
+        count += a[i] < t;
+    return count;
+}
+
+std::size_t raw_before(const std::int64_t* a, std::int64_t t, std::size_t n)
+{
+    std::size_t count = 0;
+    for (std::size_t i = 0 ; i < n ; i++)
+        count += a[i] < t;
+    return count;
+}
+
+void unit_scale(Distance* out, const Distance* a, double k, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = k * a[i];
+}
+
+void raw_scale(double* out, const double* a, double k, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = k * a[i];
+}
+
+void unit_step(Distance* x, const Velocity* v, Time dt, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        x[i] += v[i] * dt;
+}
+
+void raw_step(double* x, const double* v, double dt, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        x[i] += v[i] * dt;
+}
+
+void unit_speed(Velocity* out, const Distance* d, const Time* t, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = d[i] / t[i];
+}
+
+void raw_speed(double* out, const double* d, const double* t, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = d[i] / t[i];
+}
+
+void unit_momentum(Momentum* out, const Mass* m, const Velocity* v, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = m[i] * v[i];
+}
+
+void raw_momentum(double* out, const double* m, const double* v, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = m[i] * v[i];
+}
+
+void unit_spread(DistancePerMass* out, const Distance* d, const Mass* m, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = d[i] / m[i];
+}
+
+void raw_spread(double* out, const double* d, const double* m, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = d[i] / m[i];
+}
+
+void unit_impulse(Momentum* out, const Mass* m, const Distance* d, const Time* t, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = m[i] * d[i] / t[i];
+}
+
+void raw_impulse(double* out, const double* m, const double* d, const double* t, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        out[i] = m[i] * d[i] / t[i];
+}
+
+}
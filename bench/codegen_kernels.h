@@ -0,0 +1,54 @@
+#ifndef _FROGS_CODEGEN_KERNELS_H
+#define _FROGS_CODEGEN_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "frogs_physical_types.h"
+
+/* Each kernel comes twice, once on units and once on plain doubles that
+ * hold the same values. The codegen parity check compiles them to
+ * assembly and fails if a unit_ kernel has more instructions than the
+ * raw_ one with the same name, and frogs_bench times them. The names
+ * aren't mangled, so they can be found in the listing.
+ */
+
+namespace frogs
+{
+using Momentum = Unit<1,MomentumT>;
+using DistancePerMass = decltype(Distance{} / Mass{});
+}
+
+extern "C" {
+
+/* Unit<P,T> arithmetic */
+void unit_add(frogs::Distance* out, const frogs::Distance* a, const frogs::Distance* b, std::size_t n);
+void raw_add(double* out, const double* a, const double* b, std::size_t n);
+void unit_addf(frogs::DistanceF* out, const frogs::DistanceF* a, const frogs::DistanceF* b, std::size_t n);
+void raw_addf(float* out, const float* a, const float* b, std::size_t n);
+void unit_addns(frogs::TimeNs* out, const frogs::TimeNs* a, const frogs::TimeNs* b, std::size_t n);
+void raw_addns(std::int64_t* out, const std::int64_t* a, const std::int64_t* b, std::size_t n);
+std::size_t unit_before(const frogs::TimeNs* a, frogs::TimeNs t, std::size_t n);
+std::size_t raw_before(const std::int64_t* a, std::int64_t t, std::size_t n);
+void unit_scale(frogs::Distance* out, const frogs::Distance* a, double k, std::size_t n);
+void raw_scale(double* out, const double* a, double k, std::size_t n);
+
+/* IMPL_CONV_* conversions into another unit */
+void unit_step(frogs::Distance* x, const frogs::Velocity* v, frogs::Time dt, std::size_t n);
+void raw_step(double* x, const double* v, double dt, std::size_t n);
+void unit_speed(frogs::Velocity* out, const frogs::Distance* d, const frogs::Time* t, std::size_t n);
+void raw_speed(double* out, const double* d, const double* t, std::size_t n);
+void unit_momentum(frogs::Momentum* out, const frogs::Mass* m, const frogs::Velocity* v, std::size_t n);
+void raw_momentum(double* out, const double* m, const double* v, std::size_t n);
+
+/* Products without a conversion of their own. The quotient is a
+ * Quantity, and the product ends up in a class once it's divided again.
+ */
+void unit_spread(frogs::DistancePerMass* out, const frogs::Distance* d, const frogs::Mass* m, std::size_t n);
+void raw_spread(double* out, const double* d, const double* m, std::size_t n);
+void unit_impulse(frogs::Momentum* out, const frogs::Mass* m, const frogs::Distance* d, const frogs::Time* t, std::size_t n);
+void raw_impulse(double* out, const double* m, const double* d, const double* t, std::size_t n);
+
+}
+
+#endif // _FROGS_CODEGEN_KERNELS_H
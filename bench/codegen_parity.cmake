@@ -0,0 +1,51 @@
+# Checks that the unit kernels of codegen_kernels.cpp compile to no more
+# instructions than their raw equivalents. Run with
+#
+#   cmake -DASM=<listing> -DKERNELS=add,scale,... -P codegen_parity.cmake
+#
+# Directives and labels aren't counted, nor are moves from one register
+# to another, which only depend on how the registers were allocated.
+
+if(NOT ASM OR NOT KERNELS)
+    message(FATAL_ERROR "ASM and KERNELS have to be given")
+endif()
+
+string(REPLACE "," ";" KERNELS "${KERNELS}")
+file(STRINGS "${ASM}" lines)
+
+set(current "")
+foreach(line IN LISTS lines)
+    if(line MATCHES "^_?((unit|raw)_[A-Za-z0-9_]+):")
+        set(current "${CMAKE_MATCH_1}")
+        set(count_${current} 0)
+    elseif(current STREQUAL "")
+        continue()
+    elseif(line MATCHES "^[ \t]+\\.(size|cfi_endproc)" OR line MATCHES "^_?[A-Za-z_][A-Za-z0-9_]*:")
+        set(current "")
+    elseif(line MATCHES "^[ \t]+mov[a-z]*[ \t]+%?[a-z][a-z0-9]*,[ \t]*%?[a-z][a-z0-9]*[ \t]*$")
+        continue()
+    elseif(line MATCHES "^[ \t]+[a-z]")
+        math(EXPR count_${current} "${count_${current}} + 1")
+    endif()
+endforeach()
+
+set(failed 0)
+foreach(kernel IN LISTS KERNELS)
+    if(NOT DEFINED count_unit_${kernel} OR NOT DEFINED count_raw_${kernel})
+        message(SEND_ERROR "${kernel}: not found in ${ASM}")
+        set(failed 1)
+        continue()
+    endif()
+    set(unit ${count_unit_${kernel}})
+    set(raw ${count_raw_${kernel}})
+    if(unit GREATER raw)
+        message(SEND_ERROR "${kernel}: ${unit} instructions with units, ${raw} without")
+        set(failed 1)
+    else()
+        message(STATUS "${kernel}: ${unit} instructions with units, ${raw} without")
+    endif()
+endforeach()
+
+if(failed)
+    message(FATAL_ERROR "Units aren't free in ${ASM}")
+endif()
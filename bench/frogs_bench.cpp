@@ -0,0 +1,142 @@
+#include "frogs.h"
+#include "codegen_kernels.h"
+
+#include <chrono>
+#include <iomanip>
+#include <vector>
+
+using namespace std;
+using namespace frogs;
+
+/* Each kernel runs over arrays that fit in the cache, many times over,
+ * and the fastest of a few runs is kept. The unit and the raw kernels
+ * get the same values, so the ratio should be close to 1.
+ */
+
+static constexpr size_t N = 4096;
+static constexpr size_t Repeats = 2000;
+static constexpr size_t Runs = 7;
+
+template<typename F>
+static double NanosPerElement(F kernel)
+{
+    double best = 1e300;
+    for (size_t run = 0 ; run < Runs ; run++)
+    {
+        auto start = chrono::steady_clock::now();
+        for (size_t r = 0 ; r < Repeats ; r++)
+            kernel();
+        chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count() / (Repeats * N));
+    }
+    return best;
+}
+
+static void Report(const char* name, double unit, double raw)
+{
+    cout << left << setw(10) << name << right << fixed << setprecision(3)
+         << setw(10) << raw << setw(10) << unit
+         << setw(9) << setprecision(2) << unit / raw << endl;
+}
+
+template<typename U>
+static vector<U> Fill(U unit, double offset)
+{
+    vector<U> v(N);
+    for (size_t i = 0 ; i < N ; i++)
+        v[i] = (offset + i % 97) * unit;
+    return v;
+}
+
+static vector<double> Fill(double offset)
+{
+    vector<double> v(N);
+    for (size_t i = 0 ; i < N ; i++)
+        v[i] = offset + i % 97;
+    return v;
+}
+
+int32_t main()
+{
+    auto d = Fill(1_m, 1), d2 = Fill(1_m, 2);
+    auto t = Fill(1_sec, 1);
+    auto v = Fill(1_mps, 3);
+    auto m = Fill(1_g, 4);
+    vector<Distance> dOut(N);
+    vector<Velocity> vOut(N);
+    vector<Momentum> pOut(N);
+    vector<DistancePerMass> sOut(N);
+
+    auto a = Fill(1), b = Fill(2), c = Fill(3), e = Fill(4);
+    vector<double> out(N);
+
+    auto df = Fill(DistanceF{1_m}, 1), df2 = Fill(DistanceF{1_m}, 2);
+    vector<DistanceF> dfOut(N);
+    vector<float> af(a.begin(), a.end()), bf(b.begin(), b.end()), outf(N);
+
+    auto tn = Fill(TimeNs{1_usec}, 1), tn2 = Fill(TimeNs{1_usec}, 2);
+    vector<TimeNs> tnOut(N);
+    vector<int64_t> ai(N), bi(N), outi(N);
+    for (size_t i = 0 ; i < N ; i++)
+    {
+        ai[i] = tn[i].raw().count();
+        bi[i] = tn2[i].raw().count();
+    }
+
+    UnitArray<Distance> da{d};
+    UnitArray<Time> ta{t};
+    UnitArray<Mass> ma{m};
+    UnitArray<Velocity> va{v};
+    Distance total;
+    double rawTotal = 0;
+
+    cout << "ns per element   raw     units    ratio" << endl;
+
+    Report("add",
+           NanosPerElement([&] { unit_add(dOut.data(), d.data(), d2.data(), N); }),
+           NanosPerElement([&] { raw_add(out.data(), a.data(), b.data(), N); }));
+    Report("addf",
+           NanosPerElement([&] { unit_addf(dfOut.data(), df.data(), df2.data(), N); }),
+           NanosPerElement([&] { raw_addf(outf.data(), af.data(), bf.data(), N); }));
+    Report("addns",
+           NanosPerElement([&] { unit_addns(tnOut.data(), tn.data(), tn2.data(), N); }),
+           NanosPerElement([&] { raw_addns(outi.data(), ai.data(), bi.data(), N); }));
+    Report("before",
+           NanosPerElement([&] { unit_before(tn.data(), TimeNs{50_usec}, N); }),
+           NanosPerElement([&] { raw_before(ai.data(), 50000, N); }));
+    Report("scale",
+           NanosPerElement([&] { unit_scale(dOut.data(), d.data(), 1.0001, N); }),
+           NanosPerElement([&] { raw_scale(out.data(), a.data(), 1.0001, N); }));
+    Report("step",
+           NanosPerElement([&] { unit_step(dOut.data(), v.data(), 1_msec, N); }),
+           NanosPerElement([&] { raw_step(out.data(), c.data(), 0.001, N); }));
+    Report("speed",
+           NanosPerElement([&] { unit_speed(vOut.data(), d.data(), t.data(), N); }),
+           NanosPerElement([&] { raw_speed(out.data(), a.data(), b.data(), N); }));
+    Report("momentum",
+           NanosPerElement([&] { unit_momentum(pOut.data(), m.data(), v.data(), N); }),
+           NanosPerElement([&] { raw_momentum(out.data(), e.data(), c.data(), N); }));
+    Report("spread",
+           NanosPerElement([&] { unit_spread(sOut.data(), d.data(), m.data(), N); }),
+           NanosPerElement([&] { raw_spread(out.data(), a.data(), e.data(), N); }));
+    Report("impulse",
+           NanosPerElement([&] { unit_impulse(pOut.data(), m.data(), d.data(), t.data(), N); }),
+           NanosPerElement([&] { raw_impulse(out.data(), e.data(), a.data(), b.data(), N); }));
+
+    /* The same kernels on whole arrays, including the result they allocate */
+    Report("speed[]",
+           NanosPerElement([&] { auto r = da / ta; total += Distance{1_m} * r.data()[0]; }),
+           NanosPerElement([&] { raw_speed(out.data(), a.data(), b.data(), N); }));
+    Report("momentum[]",
+           NanosPerElement([&] { auto r = ma * va; total += Distance{1_m} * r.data()[0]; }),
+           NanosPerElement([&] { raw_momentum(out.data(), e.data(), c.data(), N); }));
+    Report("sum[]",
+           NanosPerElement([&] { total += Sum(da); }),
+           NanosPerElement([&] { for (size_t i = 0 ; i < N ; i++) rawTotal += a[i]; }));
+
+    /* Keeps the sums from being thrown away */
+    if (total.raw() + rawTotal < 0)
+        cout << total << rawTotal << endl;
+
+    return 0;
+}
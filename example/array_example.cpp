@@ -0,0 +1,89 @@
+#include "frogs.h"
+
+using namespace std;
+using namespace frogs;
+
+int32_t main()
+{
+    cout << "****************************************************************" << endl;
+    cout << "* This example shows how to work on whole arrays of quantities *" << endl;
+    cout << "****************************************************************" << endl;
+    cout << endl;
+
+    /* Arrays of masses and accelerations, each element different. Only
+     * arrays that can be written to give references to their elements,
+     * these ones are read only.
+     */
+    const size_t count = 1001;
+    vector<Mass> masses;
+    vector<Acceleration> accelerations;
+    for (size_t i = 0 ; i < count ; i++)
+    {
+        masses.push_back(1_kg + static_cast<Real>(i) * 10_g);
+        accelerations.push_back(9.8_mps2 - static_cast<Real>(i % 100) * 0.05_mps2);
+    }
+    const UnitArray<Mass> m(masses);
+    const UnitArray<Acceleration> a(accelerations);
+
+    /* Multiplying the arrays gives forces, the same as multiplying each
+     * pair of elements. The kernels may round differently from one
+     * element at a time, so they're compared by their relative error.
+     */
+    const UnitArray<Force> f = m * a;
+    Real worst = 0;
+    for (size_t i = 0 ; i < count ; i++)
+    {
+        Force each = m[i] * a[i];
+        worst = max(worst, Abs((f[i] - each) / each));
+    }
+    cout << "f = m*a, the first force is " << f[0] << " and the largest relative error is "
+         << worst << endl;
+
+    /* Dividing by the masses gives the accelerations back */
+    const UnitArray<Acceleration> back = f / m;
+    worst = 0;
+    for (size_t i = 0 ; i < count ; i++)
+        worst = max(worst, Abs((back[i] - a[i]) / a[i]));
+    cout << "f/m gives the accelerations back, the largest relative error is " << worst << endl;
+    cout << endl;
+
+    /* The reductions, against a loop over the elements. The sum adds
+     * the elements in a different order, so it may round differently.
+     */
+    Force total = 0_N, smallest = f[0], largest = f[0];
+    const UnitArray<Time> t(count, 0.5_sec);
+    decltype(Dot(f, t)) impulse{};
+    for (size_t i = 0 ; i < count ; i++)
+    {
+        total += f[i];
+        smallest = min(smallest, f[i]);
+        largest = max(largest, f[i]);
+        impulse += f[i] * t[i];
+    }
+    cout << "sum = " << Sum(f) << ", the loop gives " << total << " and the relative error is "
+         << Abs((Sum(f) - total) / total) << endl;
+    cout << "min = " << Min(f) << " and max = " << Max(f) << ", the loop gives "
+         << smallest << " and " << largest << endl;
+    cout << "dot with half a second = " << $(Dot(f, t)).toKilogramsMetersPerSecond()
+         << " kg*m/s, the loop gives " << $(impulse).toKilogramsMetersPerSecond() << " kg*m/s" << endl;
+    cout << endl;
+
+    /* Comparisons give one byte for each element */
+    auto heavy = m > 5_kg;
+    auto slower = back < a;
+    size_t differ = 0, held = 0;
+    for (size_t i = 0 ; i < count ; i++)
+    {
+        differ += (heavy[i] != (m[i] > 5_kg)) + (slower[i] != (back[i] < a[i]));
+        held += heavy[i];
+    }
+    cout << held << " masses are above 5 kg, " << differ << " comparisons differ from the elements" << endl;
+
+    /* The raw values start on a cache line */
+    size_t misaligned = 0;
+    for (auto data : {m.data(), a.data(), f.data(), back.data(), t.data()})
+        misaligned += reinterpret_cast<uintptr_t>(data) % 64 != 0;
+    cout << misaligned << " of 5 arrays don't start on a cache line" << endl;
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "frogs.h"
+
+using namespace std;
+using namespace frogs;
+
+int32_t main()
+{
+    cout << "***************************************************************" << endl;
+    cout << "* This example shows how to evaluate many expressions at once *" << endl;
+    cout << "***************************************************************" << endl;
+    cout << endl;
+
+    auto x = Var{1_m, "x"};
+    auto v = Var{2_mps, "v"};
+    auto t = Var{0_sec, "t"};
+
+    /* A batch of expressions that don't depend on each other. Each one
+     * gets a handle its result is read with.
+     */
+    const size_t count = 1000;
+    ExpressionBatch batch;
+    vector<BatchResult<Distance>> positions;
+    for (size_t i = 0 ; i < count ; i++)
+        positions.push_back(batch.add(x + v*t + static_cast<Real>(i)*1_m));
+    auto speed = batch.add(Sqrt(v*v + 1_mps*1_mps));
+
+    /* The pool splits the batch between its threads. The results are
+     * the same as evaluating each expression on its own.
+     */
+    ThreadPool pool(8);
+    t = 3_sec;
+    batch.evaluate(pool);
+    batch.commit();
+
+    size_t differ = 0;
+    for (size_t i = 0 ; i < count ; i++)
+        if (batch.get(positions[i]) != $(x + v*t + static_cast<Real>(i)*1_m))
+            differ++;
+    cout << count << " positions, " << differ << " differ from evaluating them directly" << endl;
+    cout << "speed = " << batch.get(speed) << endl;
+    cout << endl;
+
+    /* A snapshot keeps the values of the commit it was taken from */
+    auto before = batch.snapshot();
+    t = 4_sec;
+    batch.evaluate(pool);
+    batch.commit();
+    cout << "first position was " << before->get(positions[0])
+         << " and is now " << batch.get(positions[0]) << endl;
+
+    /* A result added since the last commit can't be read yet */
+    auto late = batch.add(v*t);
+    cout << boolalpha << "late result readable: " << batch.snapshot()->has(late);
+    batch.evaluate(pool);
+    batch.commit();
+    cout << ", after a commit: " << batch.snapshot()->has(late) << " " << batch.get(late) << endl;
+    cout << endl;
+
+    /* One expression can also be evaluated for many values of its
+     * variables. The values go through the tape in blocks of BatchLanes,
+     * and the count here isn't a multiple of it or of the vector width,
+     * so the last block is a partial one. Each result is the same as
+     * setting the variables and evaluating the expression.
+     */
+    const size_t values = 3 * BatchLanes + 5;
+    vector<Distance> starts;
+    vector<Velocity> speeds;
+    for (size_t i = 0 ; i < values ; i++)
+    {
+        starts.push_back(static_cast<Real>(i) * 0.5_m);
+        speeds.push_back(1_mps + static_cast<Real>(i % 7) * 0.25_mps);
+    }
+    vector<Distance> reached(values);
+    vector<Velocity> speedsOut(values);
+    t = 2.5_sec;
+    EvaluateBatch(x + v*t, reached, Bind(x, starts), Bind(v, speeds));
+    EvaluateBatch(Sqrt(v*v + 1_mps*1_mps), v, speeds, speedsOut);
+
+    differ = 0;
+    for (size_t i = 0 ; i < values ; i++)
+    {
+        x = starts[i];
+        v = speeds[i];
+        differ += (reached[i] != $(x + v*t)) + (speedsOut[i] != $(Sqrt(v*v + 1_mps*1_mps)));
+    }
+    cout << values << " sets of values, " << differ << " results differ from evaluating them directly" << endl;
+    cout << endl;
+
+    /* Readers on other threads see whole evaluations. Every snapshot they
+     * take has positions exactly 1 meter apart, while the batch is being
+     * evaluated and committed over and over.
+     */
+    atomic<bool> done{false};
+    atomic<size_t> torn{0};
+    thread reader([&]
+    {
+        while (!done)
+        {
+            auto snapshot = batch.snapshot();
+            Distance first = snapshot->get(positions[0]);
+            for (size_t i = 1 ; i < count ; i++)
+                if (snapshot->get(positions[i]) - first != static_cast<Real>(i)*1_m)
+                    torn++;
+        }
+    });
+    for (size_t round = 0 ; round < 200 ; round++)
+    {
+        t = static_cast<Real>(round)*1_sec;
+        batch.evaluate(pool);
+        batch.commit();
+    }
+    done = true;
+    reader.join();
+    cout << "snapshots with values from different evaluations: " << torn << endl;
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "frogs.h"
+
+using namespace std;
+using namespace frogs;
+
+int32_t main()
+{
+    cout << "***********************************************************" << endl;
+    cout << "* This example shows how to compile expressions to a tape *" << endl;
+    cout << "***********************************************************" << endl;
+    cout << endl;
+
+    /* Same distance formula as the differentiation example */
+    auto t = Var{0_sec, "t"};
+    auto distance = 0.2_mps2*t*t + 10_mps*t + 20_m;
+    auto velocity = Diff(distance, t);
+
+    /* Compiling an expression flattens it into a list of instructions
+     * that run on plain numbers. The result is still typed, so $() on
+     * a compiled distance gives a Distance.
+     */
+    auto fastDistance = Compile(distance);
+    auto fastVelocity = Compile(velocity);
+
+    cout << "distance compiles to " << fastDistance << endl;
+    cout << "velocity compiles to " << fastVelocity << endl;
+    cout << endl;
+
+    /* Differentiation repeats parts of the original formula. The tape
+     * shares identical subtrees, so it has fewer nodes than the tree.
+     */
+    cout << "velocity has " << NodeCount(velocity) << " nodes as a tree and "
+         << fastVelocity.nodes() << " nodes on the tape" << endl;
+
+    /* The tape only simplifies what gives the same result for any input.
+     * Treating the numbers as real numbers also merges 2*(0.2*t) into
+     * 0.4*t, but the result may round differently.
+     */
+    cout << "with algebraic folding it has "
+         << Compile(velocity, TapeFolding::Algebraic).nodes() << " nodes" << endl;
+    cout << endl;
+
+    /* They read the same variables as the original expressions */
+    t = 3_sec;
+    cout << "distance(" << $(t) << ") = " << $(distance) << " = " << $(fastDistance) << endl;
+    cout << "velocity(" << $(t) << ") = " << $(velocity) << " = " << $(fastVelocity) << endl;
+    cout << endl;
+
+    /* The distance is a polynomial in t. Horner() turns it into a single
+     * node that multiplies and adds twice, and its derivative is worked
+     * out on the coefficients.
+     */
+    auto polyDistance = Horner(distance);
+    cout << "distance as a polynomial is " << polyDistance << " = " << $(polyDistance) << endl;
+    cout << "its velocity is " << Diff(polyDistance, t) << " = " << $(Diff(polyDistance, t)) << endl;
+    cout << endl;
+
+    /* A cached tape keeps the value of every instruction, and only runs
+     * again the ones that depend on a variable that was written. Writing
+     * one variable, or assigning another variable to it, gives the same
+     * value as evaluating the expression.
+     */
+    auto width = Var{2_m, "width"};
+    auto depth = Var{3_m, "depth"};
+    auto area = width*width + 2.0*width*depth + Sqrt(depth*depth*depth*depth + 1_m*1_m*1_m*1_m);
+    auto cachedArea = CompileCached(area);
+    cout << "area = " << $(cachedArea) << " = " << $(area) << ", it ran "
+         << cachedArea.work() << " instructions" << endl;
+    width = 4_m;
+    cout << "area = " << $(cachedArea) << " = " << $(area) << ", it ran "
+         << cachedArea.work() << " instructions after writing the width" << endl;
+    auto otherDepth = Var{5_m, "otherDepth"};
+    depth = otherDepth;
+    cout << "area = " << $(cachedArea) << " = " << $(area) << " after assigning "
+         << otherDepth << " to " << depth << endl;
+    cout << endl;
+
+    /* The power of a car going up a slope. When only its speed changes,
+     * specializing the tape on the mass and the slope works out the force
+     * once, and what's left is a single multiplication by the speed.
+     */
+    auto mass = Var{1200_kg, "mass"};
+    auto slope = Var{0.05_rad, "slope"};
+    auto speed = Var{20_mps, "speed"};
+    auto power = (mass*9.8_mps2*Sin(slope) + 0.01*mass*9.8_mps2*Cos(slope)) * speed;
+    auto perSpeed = Specialize(power, mass, slope);
+    cout << "power has " << Compile(power).nodes() << " nodes on the tape and "
+         << perSpeed.nodes() << " nodes once the mass and the slope are frozen" << endl;
+    cout << "it compiles to " << Compile(power) << " and specializes to " << perSpeed << endl;
+    for (auto currSpeed : {10_mps, 20_mps, 30_mps})
+    {
+        speed = currSpeed;
+        cout << "power(" << $(speed) << ") = " << $(perSpeed) << " = " << $(power) << endl;
+    }
+    cout << endl;
+
+    /* Bindings keep their own values for the variables of a tape, so one
+     * compiled distance serves several cars that are each at a different
+     * time, without writing t itself.
+     */
+    vector<Time> times{10_sec, 20_sec, 30_sec};
+    vector<Bindings<Distance>> cars(times.size(), Bindings<Distance>{fastDistance});
+    for (size_t i = 0 ; i < cars.size() ; i++)
+        cars[i].set(t, times[i]);
+    for (size_t i = 0 ; i < cars.size() ; i++)
+        cout << "car " << i << " has gone " << cars[i].run() << " = "
+             << 0.2_mps2*times[i]*times[i] + 10_mps*times[i] + 20_m << endl;
+    cout << "t is still " << $(t) << endl;
+    cout << endl;
+
+    /* In a hot loop we could skip the variable altogether and feed
+     * the values into the slot of the tape directly.
+     */
+    auto slot = fastDistance.slot(t);
+    for (auto currTime : Range(5_sec))
+    {
+        fastDistance.set(slot, currTime);
+        cout << "distance(" << currTime << ") = " << fastDistance.run() << endl;
+    }
+
+    return 0;
+}
@@ -39,6 +39,35 @@ int32_t main()
         cout << "velocity(" << $(t) << ") = " << $(velocity) << endl;
         cout << "acceleration(" << $(t) << ") = " << $(acceleration) << endl;
     }
+    cout << endl;
+
+    /* A dual number as the value of the variable carries the derivative
+     * along with the value, so the distance formula gives the velocity
+     * in the same evaluation without building Diff().
+     */
+    auto dualTime = Var{Seed(0_sec), "dualTime"};
+    auto dualDistance = 0.2_mps2*dualTime*dualTime + 10_mps*dualTime + 20_m;
+    cout << "Velocities from dual numbers next to Diff():" << endl;
+    for (auto currTime : Range(5_sec))
+    {
+        t = currTime;
+        dualTime = Seed(currTime);
+        cout << "velocity(" << $(t) << ") = " << Derivative($(dualDistance), dualTime)
+             << " = " << $(Diff(distance, t)) << endl;
+    }
+    cout << endl;
+
+    /* The gradient gives the derivative with respect to each variable at
+     * once, in one pass over the compiled expression. Here it's the area
+     * of a rectangle with a square on one side.
+     */
+    auto w = Var{3_m, "width"};
+    auto h = Var{2_m, "height"};
+    auto area = w*h + w*w;
+    auto [dw, dh] = Gradient(area, w, h);
+    cout << "Gradient of the area " << area << ":" << endl;
+    cout << "by width = " << dw << " = " << $(Diff(area, w)) << endl;
+    cout << "by height = " << dh << " = " << $(Diff(area, h)) << endl;
 
     return 0;
 }
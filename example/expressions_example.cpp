@@ -60,6 +60,22 @@ int32_t main()
     cout << "Angle expression = " << angle << endl;
     cout << "Velocity_x = " << velocity_x << endl;
     cout << "Velocity_y = " << velocity_y << endl;
+    cout << endl;
+
+    /* Every expression has a type of its own, so a container of different
+     * formulas needs AnyExpr to hold them. They're still evaluated on
+     * the current values of the variables.
+     */
+    vector<AnyExpr<Distance>> formulas{x, distance, velocity * t, velocity_x + velocity_y};
+    cout << "Distances kept together:" << endl;
+    for (auto& formula : formulas)
+        cout << formula << " = " << $(formula) << endl;
+    cout << endl;
+
+    /* Expressions of constants can be evaluated at compile time */
+    static_assert($(Const{2.0}*Const{3.0}) == 6.0);
+    constexpr Distance walked = $(Const{2_mps}*Const{10_sec} + Const{5_m});
+    cout << "Worked out at compile time: " << walked << endl;
 
     return 0;
 }
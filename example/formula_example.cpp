@@ -0,0 +1,70 @@
+#include "frogs.h"
+
+using namespace std;
+using namespace frogs;
+
+int32_t main()
+{
+    cout << "*****************************************************************" << endl;
+    cout << "* This example shows how to use formulas only known at run time *" << endl;
+    cout << "*****************************************************************" << endl;
+    cout << endl;
+
+    /* The same distance formula as the other examples, but as text, like
+     * it would be read from a config file. The inputs are declared with
+     * their types before it's parsed.
+     */
+    Formula formula;
+    auto time = formula.input<Time>("t");
+    formula.parse("0.2 mps2 * t*t + 10 mps * t + 20 m");
+    cout << "parsed " << formula << " of dimension " << formula.dimension() << endl;
+
+    /* It gives the same values as the template expression */
+    auto t = Var{0_sec, "t"};
+    auto distance = 0.2_mps2*t*t + 10_mps*t + 20_m;
+    for (auto currTime : Range(4_sec))
+    {
+        formula.set(time, currTime);
+        t = currTime;
+        cout << "distance(" << currTime << ") = " << formula.eval<Distance>() << " = " << $(distance) << endl;
+    }
+
+    /* An input can also read a variable whenever the formula is evaluated */
+    Formula speed;
+    speed.input("t", t);
+    speed.parse("sqrt(sqr(0.4 mps2 * t + 10 mps) + sqr(3 mps))");
+    t = 5_sec;
+    cout << "speed(" << $(t) << ") = " << speed.eval<Velocity>() << " = "
+         << $(Sqrt(Sqr(0.4_mps2*t + 10_mps) + Sqr(3_mps))) << endl;
+    cout << endl;
+
+    /* The dimensions are checked as the formula is built, and the errors
+     * say where in the text they are.
+     */
+    for (auto text : {"1 m + 2 sec", "2 * (t + 1 sec", "t * 3 furlongs"})
+    {
+        Formula wrong;
+        wrong.input<Time>("t");
+        try
+        {
+            wrong.parse(text);
+            cout << "\"" << text << "\" parsed" << endl;
+        }
+        catch (const FormulaError& e)
+        {
+            cout << "\"" << text << "\" failed at " << e.position() << ": " << e.what() << endl;
+        }
+    }
+
+    /* So is the type that it's evaluated as */
+    try
+    {
+        formula.eval<Time>();
+    }
+    catch (const FormulaError& e)
+    {
+        cout << "evaluating a distance as a time failed: " << e.what() << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "frogs.h"
+
+using namespace std;
+using namespace frogs;
+
+int32_t main()
+{
+    cout << "***********************************************************" << endl;
+    cout << "* This example shows the numerical methods on expressions *" << endl;
+    cout << "***********************************************************" << endl;
+    cout << endl;
+
+    /* An interval as the value of a variable bounds the expression over
+     * all of its values at once. Sampling the same formula densely never
+     * leaves the bounds.
+     */
+    auto span = Var{Interval{0_sec, 10_sec}, "t"};
+    auto t = Var{0_sec, "t"};
+    auto bounds = $(0.2_mps2*span*span - 3_mps*span + 20_m);
+    auto distance = 0.2_mps2*t*t - 3_mps*t + 20_m;
+
+    size_t samples = 10001, outside = 0;
+    for (size_t i = 0 ; i < samples ; i++)
+    {
+        t = static_cast<Real>(i) / (samples - 1) * 10_sec;
+        if (!bounds.contains($(distance)))
+            outside++;
+    }
+    cout << "distance over " << $(span) << " is within " << bounds << ", "
+         << outside << " of " << samples << " samples are outside" << endl;
+
+    /* Sin and Cos look for peaks and troughs inside the interval */
+    outside = 0;
+    for (size_t k = 0 ; k < 100 ; k++)
+    {
+        Angle lo = static_cast<Real>(k) * 0.37_rad - 15_rad;
+        Angle width = static_cast<Real>(k % 10) * 0.5_rad;
+        auto sine = Sin(Interval{lo, lo + width});
+        auto cosine = Cos(Interval{lo, lo + width});
+        for (size_t i = 0 ; i <= 1000 ; i++)
+        {
+            Angle a = lo + static_cast<Real>(i) / 1000 * width;
+            if (!sine.contains(Sin(a)) || !cosine.contains(Cos(a)))
+                outside++;
+        }
+    }
+    cout << "sin and cos over 100 intervals, " << outside << " samples are outside" << endl;
+    cout << endl;
+
+    /* Solving finds where an expression takes a value. The root of the
+     * quadratic is checked against the formula for it.
+     */
+    auto motion = 0.2_mps2*t*t + 10_mps*t + 20_m;
+    auto when = Solve(motion == 100_m, t, Interval{0_sec, 60_sec});
+    Time exact = (Sqrt(10_mps*10_mps + 4*0.2_mps2*80_m) - 10_mps) / (2*0.2_mps2);
+    t = *when;
+    cout << "100 meters are reached at " << *when << ", the formula gives " << exact
+         << " and the distance there is " << $(motion) << endl;
+
+    /* A batch solves for many targets at once, each bound to its lane */
+    auto target = Var{0_m, "target"};
+    vector<Distance> targets;
+    for (size_t i = 0 ; i < 1000 ; i++)
+        targets.push_back(21_m + static_cast<Real>(i) * 1_m);
+    vector<Time> roots(targets.size());
+    auto solved = SolveBatch(motion == target, t, Interval{0_sec, 60_sec},
+                             roots.data(), roots.size(), Bind(target, targets));
+    Real worst = 0;
+    for (size_t i = 0 ; i < targets.size() ; i++)
+    {
+        Time root = (Sqrt(10_mps*10_mps + 4*0.2_mps2*(targets[i] - 20_m)) - 10_mps) / (2*0.2_mps2);
+        worst = max(worst, Abs((roots[i] - root) / root));
+    }
+    cout << solved << " of " << targets.size() << " targets solved, the largest relative error is "
+         << worst << endl;
+    cout << endl;
+
+    /* Integrating a velocity over time gives a distance. The adaptive
+     * rule also handles a narrow peak, and both are checked against
+     * their antiderivatives.
+     */
+    auto velocity = 0.4_mps2*t + 10_mps;
+    Distance travelled = Integrate(velocity, t, Range{0_sec, 10_sec});
+    cout << "in 10 seconds it travels " << travelled << ", the antiderivative gives "
+         << 0.2_mps2*10_sec*10_sec + 10_mps*10_sec << endl;
+
+    auto x = Var{0.0, "x"};
+    Real peak = Integrate(1.0 / (1.0 + 10000.0*x*x), x, Range{-1.0, 1.0});
+    Real expected = 2.0 * atan(100.0) / 100.0;
+    cout << "a peak of width 0.01 integrates to " << peak << ", the relative error is "
+         << Abs((peak - expected) / expected) << endl;
+    cout << endl;
+
+    /* Integrating a system of equations, for many systems at once. Each
+     * one has its own drag, and its speed decays exponentially. Both
+     * integrators are checked against the exact solution, and running
+     * them on a pool gives the same values as running them on one thread.
+     */
+    auto time = Var{0_sec, "time"};
+    auto position = Var{0_m, "position"};
+    auto speed = Var{0_mps, "speed"};
+    auto drag = Var{0.0, "drag"};
+    auto system = Ode(time, Rate(position, speed), Rate(speed, -drag*speed/1_sec));
+
+    const size_t systems = 1000;
+    vector<Real> drags(systems);
+    for (size_t i = 0 ; i < systems ; i++)
+        drags[i] = 0.1 + 0.002 * static_cast<Real>(i);
+    auto exactSpeed = [&](size_t i) { return 10_mps * exp(-drags[i] * 2.0); };
+
+    vector<Distance> xs(systems), xsPool(systems);
+    vector<Velocity> vs(systems, 10_mps), vsPool(systems, 10_mps);
+    ThreadPool pool(4);
+    system.rk4(1_msec, 2000, State(position, xs), State(speed, vs), Bind(drag, drags));
+    system.rk4(pool, 1_msec, 2000, State(position, xsPool), State(speed, vsPool), Bind(drag, drags));
+
+    worst = 0;
+    size_t same = 0;
+    for (size_t i = 0 ; i < systems ; i++)
+    {
+        worst = max(worst, Abs((vs[i] - exactSpeed(i)) / exactSpeed(i)));
+        same += (xs[i] == xsPool[i] && vs[i] == vsPool[i]);
+    }
+    cout << "rk4 over 2 seconds, the largest relative error is " << worst << ", "
+         << same << " of " << systems << " systems are the same on the pool" << endl;
+
+    vector<Distance> xs45(systems);
+    vector<Velocity> vs45(systems, 10_mps);
+    auto finished = system.rk45(pool, 2_sec, 1e-10, State(position, xs45), State(speed, vs45), Bind(drag, drags));
+    worst = 0;
+    for (size_t i = 0 ; i < systems ; i++)
+        worst = max(worst, Abs((vs45[i] - exactSpeed(i)) / exactSpeed(i)));
+    cout << "rk45 over 2 seconds, " << finished << " systems finished and the largest relative error is "
+         << worst << endl;
+
+    return 0;
+}
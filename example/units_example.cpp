@@ -34,6 +34,23 @@ int32_t main()
     cout << "v in kmph = " << $(v).toKilometersPerHour() << endl;
     cout << "v in mps = " << $(v).toMetersPerSecond() << endl;
     cout << "v in mph = " << $(v).toMilesPerHour() << endl;
+    cout << endl;
+
+    /* Mass times acceleration is a force in newtons. Dividing it by either
+     * of them gives the other one back, and over a time it's a momentum.
+     */
+    auto m = 2_kg;
+    auto a = 9.8_mps2;
+    Force f = m*a;
+    Acceleration fOverM = f/m;
+    Mass fOverA = f/a;
+    auto p = f*1_sec;
+
+    cout << "f = m*a = " << f << endl;
+    cout << "f/m = " << fOverM << endl;
+    cout << "f/a in kg = " << $(fOverA).toKilograms() << endl;
+    cout << "f over a second in kg*m/s = " << $(p).toKilogramsMetersPerSecond() << endl;
+    cout << "and back to a force = " << $(p/1_sec) << endl;
 
     return 0;
 }
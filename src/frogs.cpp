@@ -1,15 +1,1075 @@
 #include "frogs_expressions.h"
+#include "frogs_graph.h"
+#include "frogs_parallel.h"
+#include "frogs_ode.h"
 
-#include <regex>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace frogs
 {
 
-Integer ___numVars = 0;
+static std::atomic<std::uint32_t> ___numVars{0};
+static std::mutex ___namesLock;
 
-Str conv2str(Real v)
+/* The names are made on first use, since variables with static storage
+ * in other files may be named before this file is initialized.
+ */
+struct __NameTable
 {
-    return std::regex_replace(std::to_string(v), std::regex{"(\\.|)0+$"}, "");
+    std::vector<Str> names{Str{}};
+    std::unordered_map<Str, std::uint32_t> ids;
+};
+
+static __NameTable& __Names()
+{
+    static __NameTable table;
+    return table;
+}
+
+std::uint32_t __NewVarId()
+{
+    return ++___numVars;
+}
+
+std::uint32_t __InternName(const Str& name)
+{
+    std::lock_guard<std::mutex> lock{___namesLock};
+    auto& table = __Names();
+    auto found = table.ids.find(name);
+    if (found != table.ids.end())
+        return found->second;
+    table.names.push_back(name);
+    return table.ids[name] = table.names.size() - 1;
+}
+
+Str __VarName(std::uint32_t id, std::uint32_t name)
+{
+    Str s;
+    __AppendVarName(s, id, name);
+    return s;
+}
+
+void __AppendVarName(Str& out, std::uint32_t id, std::uint32_t name)
+{
+    if (name == 0)
+    {
+        out += "var";
+        append2str(out, static_cast<Integer>(id));
+        return;
+    }
+    std::lock_guard<std::mutex> lock{___namesLock};
+    out += __Names().names[name];
+}
+
+void append2str(Str& out, Real v)
+{
+    char buffer[32];
+    auto end = std::to_chars(buffer, buffer + sizeof(buffer), v).ptr;
+    out.append(buffer, end);
+}
+
+void append2str(Str& out, float v)
+{
+    char buffer[32];
+    auto end = std::to_chars(buffer, buffer + sizeof(buffer), v).ptr;
+    out.append(buffer, end);
+}
+
+void append2str(Str& out, long double v)
+{
+    char buffer[64];
+    auto end = std::to_chars(buffer, buffer + sizeof(buffer), v).ptr;
+    out.append(buffer, end);
+}
+
+/* Runtime formulas */
+
+void Dimension::appendTo(Str& out) const
+{
+    static const char* names[BaseDims] = {"m", "kg", "s", "rad", "px"};
+    bool first = true;
+    for (std::size_t i = 0 ; i < BaseDims ; i++)
+    {
+        if (m_exp[i] == 0)
+            continue;
+        if (!first)
+            out += ' ';
+        out += names[i];
+        if (m_exp[i] != 1)
+            append2str(out, static_cast<int>(m_exp[i]));
+        first = false;
+    }
+    if (first)
+        out += '1';
+}
+
+#define FORMULA_UNIT(ClassName, P, Sym) \
+    {#Sym + 1, DimTraits<Unit<P,ClassName>>::dim(), \
+     ClassName<P>::convFrom##Sym * DimTraits<Unit<P,ClassName>>::scale()},
+
+static const FormulaUnit ___formulaUnits[] = {
+    FORMULA_UNIT(DistanceT, 1, _m)
+    FORMULA_UNIT(DistanceT, 1, _cm)
+    FORMULA_UNIT(DistanceT, 1, _mm)
+    FORMULA_UNIT(DistanceT, 1, _um)
+    FORMULA_UNIT(DistanceT, 1, _nm)
+    FORMULA_UNIT(DistanceT, 1, _km)
+    FORMULA_UNIT(DistanceT, 1, _inch)
+    FORMULA_UNIT(DistanceT, 1, _ft)
+    FORMULA_UNIT(DistanceT, 1, _miles)
+    FORMULA_UNIT(DistanceT, 1, _yd)
+    FORMULA_UNIT(DistanceT, 2, _m2)
+    FORMULA_UNIT(DistanceT, 2, _cm2)
+    FORMULA_UNIT(DistanceT, 2, _mm2)
+    FORMULA_UNIT(DistanceT, 2, _um2)
+    FORMULA_UNIT(DistanceT, 2, _nm2)
+    FORMULA_UNIT(DistanceT, 2, _km2)
+    FORMULA_UNIT(DistanceT, 2, _inch2)
+    FORMULA_UNIT(DistanceT, 2, _ft2)
+    FORMULA_UNIT(DistanceT, 2, _miles2)
+    FORMULA_UNIT(DistanceT, 2, _yd2)
+    FORMULA_UNIT(DistanceT, 2, _acre)
+    FORMULA_UNIT(DistanceT, 3, _m3)
+    FORMULA_UNIT(DistanceT, 3, _cm3)
+    FORMULA_UNIT(DistanceT, 3, _mm3)
+    FORMULA_UNIT(DistanceT, 3, _um3)
+    FORMULA_UNIT(DistanceT, 3, _nm3)
+    FORMULA_UNIT(DistanceT, 3, _km3)
+    FORMULA_UNIT(DistanceT, 3, _inch3)
+    FORMULA_UNIT(DistanceT, 3, _ft3)
+    FORMULA_UNIT(DistanceT, 3, _miles3)
+    FORMULA_UNIT(DistanceT, 3, _yd3)
+    FORMULA_UNIT(DistanceT, 3, _l)
+    FORMULA_UNIT(DistanceT, 3, _ml)
+    FORMULA_UNIT(DistanceT, 3, _gal)
+    FORMULA_UNIT(AngleT, 1, _rad)
+    FORMULA_UNIT(AngleT, 1, _deg)
+    FORMULA_UNIT(TimeT, 1, _hours)
+    FORMULA_UNIT(TimeT, 1, _minutes)
+    FORMULA_UNIT(TimeT, 1, _sec)
+    FORMULA_UNIT(TimeT, 1, _msec)
+    FORMULA_UNIT(TimeT, 1, _usec)
+    FORMULA_UNIT(TimeT, 1, _nsec)
+    FORMULA_UNIT(TimeT, 2, _sec2)
+    FORMULA_UNIT(TimeT, -1, _Hz)
+    FORMULA_UNIT(TimeT, -1, _fps)
+    FORMULA_UNIT(TimeT, -2, _Hz2)
+    FORMULA_UNIT(VelocityT, 1, _kmph)
+    FORMULA_UNIT(VelocityT, 1, _mph)
+    FORMULA_UNIT(VelocityT, 1, _mps)
+    FORMULA_UNIT(AccelerationT, 1, _mps2)
+    FORMULA_UNIT(AccelerationT, 1, _mmps2)
+    FORMULA_UNIT(AccelerationT, 1, _umps2)
+    FORMULA_UNIT(AccelerationT, 1, _nmps2)
+    FORMULA_UNIT(MassT, 1, _kg)
+    FORMULA_UNIT(MassT, 1, _g)
+    FORMULA_UNIT(MassT, 1, _mg)
+    FORMULA_UNIT(MassT, 1, _ug)
+    FORMULA_UNIT(MassT, 1, _ng)
+    FORMULA_UNIT(MassT, 1, _lb)
+    FORMULA_UNIT(MassT, 1, _oz)
+    FORMULA_UNIT(MassFlowT, 1, _kgps)
+    FORMULA_UNIT(MassFlowT, 1, _gps)
+    FORMULA_UNIT(MomentumT, 1, _kgmps)
+    FORMULA_UNIT(ForceT, 1, _N)
+    FORMULA_UNIT(EnergyT, 1, _J)
+    FORMULA_UNIT(EnergyT, 1, _kJ)
+    FORMULA_UNIT(EnergyT, 1, _MJ)
+    FORMULA_UNIT(EnergyT, 1, _GJ)
+    FORMULA_UNIT(EnergyT, 1, _mJ)
+    FORMULA_UNIT(EnergyT, 1, _uJ)
+    FORMULA_UNIT(EnergyT, 1, _nJ)
+    FORMULA_UNIT(EnergyT, 1, _kWh)
+    FORMULA_UNIT(EnergyT, 1, _cal)
+    FORMULA_UNIT(EnergyT, 1, _kcal)
+    FORMULA_UNIT(PowerT, 1, _GW)
+    FORMULA_UNIT(PowerT, 1, _MW)
+    FORMULA_UNIT(PowerT, 1, _kW)
+    FORMULA_UNIT(PowerT, 1, _W)
+    FORMULA_UNIT(PowerT, 1, _mW)
+    FORMULA_UNIT(PowerT, 1, _uW)
+    FORMULA_UNIT(PixelsT, 1, _px)
+    FORMULA_UNIT(DpiT, 1, _dpi)
+};
+
+const FormulaUnit* FindFormulaUnit(const Str& name)
+{
+    for (auto& unit : ___formulaUnits)
+        if (name == unit.name)
+            return &unit;
+    return nullptr;
+}
+
+std::uint32_t Formula::node(GraphOp op, std::uint32_t a, std::uint32_t b, Real value, Dimension dim)
+{
+    m_nodes.push_back({op, a, b, value, dim});
+    return m_nodes.size() - 1;
+}
+
+std::uint32_t Formula::addInput(Input input)
+{
+    if (findInput(input.name) != npos)
+        throw FormulaError{"Input " + input.name + " is declared twice"};
+    m_inputs.push_back(input);
+    auto& stored = m_inputs.back();
+    if (!stored.var)
+        stored.var = &stored;
+    m_compiled = false;
+    return m_inputs.size() - 1;
+}
+
+std::uint32_t Formula::findInput(const Str& name) const
+{
+    for (std::uint32_t i = 0 ; i < m_inputs.size() ; i++)
+        if (m_inputs[i].name == name)
+            return i;
+    return npos;
+}
+
+static const char* __GraphOpName(GraphOp op)
+{
+    switch (op)
+    {
+    case GraphOp::Add:   return " + ";
+    case GraphOp::Sub:   return " - ";
+    case GraphOp::Mul:   return " * ";
+    case GraphOp::Div:   return " / ";
+    case GraphOp::Neg:   return "-";
+    case GraphOp::Abs:   return "Abs";
+    case GraphOp::Sqrt:  return "Sqrt";
+    case GraphOp::Sqr:   return "Sqr";
+    case GraphOp::Cube:  return "Cube";
+    case GraphOp::Cos:   return "Cos";
+    case GraphOp::Sin:   return "Sin";
+    case GraphOp::Tan:   return "Tan";
+    case GraphOp::ACos:  return "ACos";
+    case GraphOp::ASin:  return "ASin";
+    case GraphOp::ATan:  return "ATan";
+    case GraphOp::ATan2: return "ATan2";
+    default:             return "";
+    }
+}
+
+std::uint32_t Formula::apply(GraphOp op, std::uint32_t a, std::uint32_t b)
+{
+    constexpr Dimension angle{0, 0, 0, 1};
+    Dimension da = m_nodes[a].dim;
+    Dimension db = m_nodes[b].dim;
+    Dimension dim;
+    switch (op)
+    {
+    case GraphOp::Add:
+    case GraphOp::Sub:
+        if (da != db)
+            throw FormulaError{Str{"Can't use"} + __GraphOpName(op) + "on " + da.toString()
+                               + " and " + db.toString()};
+        dim = da;
+        break;
+    case GraphOp::Mul:   dim = da * db; break;
+    case GraphOp::Div:   dim = da / db; break;
+    case GraphOp::Neg:
+    case GraphOp::Abs:   dim = da; break;
+    case GraphOp::Sqrt:
+        if (!da.hasRoot(2))
+            throw FormulaError{"Can't take the square root of " + da.toString()};
+        dim = da.root(2);
+        break;
+    case GraphOp::Sqr:   dim = da.pow(2); break;
+    case GraphOp::Cube:  dim = da.pow(3); break;
+    case GraphOp::Cos:
+    case GraphOp::Sin:
+    case GraphOp::Tan:
+        if (da != angle)
+            throw FormulaError{Str{__GraphOpName(op)} + " needs an angle, not " + da.toString()};
+        break;
+    case GraphOp::ACos:
+    case GraphOp::ASin:
+    case GraphOp::ATan:
+        if (!da.dimensionless())
+            throw FormulaError{Str{__GraphOpName(op)} + " needs a plain number, not " + da.toString()};
+        dim = angle;
+        break;
+    case GraphOp::ATan2:
+        if (da != db)
+            throw FormulaError{"ATan2 needs the same dimensions, not " + da.toString()
+                               + " and " + db.toString()};
+        dim = angle;
+        break;
+    default:
+        throw FormulaError{"Constants and inputs have their own functions"};
+    }
+    return node(op, a, b, 0.0, dim);
+}
+
+static TapeOp __TapeOpOf(GraphOp op)
+{
+    switch (op)
+    {
+    case GraphOp::Add:   return TapeOp::Add;
+    case GraphOp::Sub:   return TapeOp::Sub;
+    case GraphOp::Mul:   return TapeOp::Mul;
+    case GraphOp::Div:   return TapeOp::Div;
+    case GraphOp::Neg:   return TapeOp::Neg;
+    case GraphOp::Abs:   return TapeOp::Abs;
+    case GraphOp::Sqrt:  return TapeOp::Sqrt;
+    case GraphOp::Sqr:   return TapeOp::Sqr;
+    case GraphOp::Cube:  return TapeOp::Cube;
+    case GraphOp::Cos:   return TapeOp::Cos;
+    case GraphOp::Sin:   return TapeOp::Sin;
+    case GraphOp::Tan:   return TapeOp::Tan;
+    case GraphOp::ACos:  return TapeOp::ACos;
+    case GraphOp::ASin:  return TapeOp::ASin;
+    case GraphOp::ATan:  return TapeOp::ATan;
+    default:             return TapeOp::ATan2;
+    }
+}
+
+/* Nodes are always made after their operands, so one pass from the root
+ * down marks what's used and one pass up emits it.
+ */
+void Formula::compile()
+{
+    if (m_root == npos)
+        throw FormulaError{"Formula is empty"};
+
+    std::vector<bool> live(m_root + 1, false);
+    live[m_root] = true;
+    for (std::uint32_t n = m_root + 1 ; n-- > 0 ; )
+    {
+        auto& node = m_nodes[n];
+        if (!live[n] || node.op == GraphOp::Const || node.op == GraphOp::Input)
+            continue;
+        live[node.a] = true;
+        if (TapeCode::isBinary(__TapeOpOf(node.op)))
+            live[node.b] = true;
+    }
+
+    TapeCode tape;
+    std::vector<std::uint32_t> regs(m_root + 1, npos);
+    for (std::uint32_t n = 0 ; n <= m_root ; n++)
+    {
+        if (!live[n])
+            continue;
+        auto& node = m_nodes[n];
+        if (node.op == GraphOp::Const)
+            regs[n] = tape.constant(node.value);
+        else if (node.op == GraphOp::Input)
+        {
+            auto& input = m_inputs[node.a];
+            regs[n] = tape.emit(TapeOp::Scale, tape.slotOf(input.var, input.read, input.versionOf),
+                                0, input.scale);
+        }
+        else
+            regs[n] = tape.emit(__TapeOpOf(node.op), regs[node.a], regs[node.b]);
+    }
+    tape.setResult(regs[m_root]);
+    tape.compact();
+    m_tape = std::move(tape);
+    m_compiled = true;
+}
+
+void Formula::appendNode(Str& out, std::uint32_t n) const
+{
+    auto& node = m_nodes[n];
+    switch (node.op)
+    {
+    case GraphOp::Const:
+        append2str(out, node.value);
+        if (!node.dim.dimensionless())
+        {
+            out += ' ';
+            node.dim.appendTo(out);
+        }
+        break;
+    case GraphOp::Input:
+        out += m_inputs[node.a].name;
+        break;
+    case GraphOp::Add:
+    case GraphOp::Sub:
+    case GraphOp::Mul:
+    case GraphOp::Div:
+        out += '(';
+        appendNode(out, node.a);
+        out += __GraphOpName(node.op);
+        appendNode(out, node.b);
+        out += ')';
+        break;
+    case GraphOp::Neg:
+        out += "( -";
+        appendNode(out, node.a);
+        out += " )";
+        break;
+    case GraphOp::ATan2:
+        out += "ATan2( ";
+        appendNode(out, node.a);
+        out += ", ";
+        appendNode(out, node.b);
+        out += " )";
+        break;
+    default:
+        out += __GraphOpName(node.op);
+        out += "( ";
+        appendNode(out, node.a);
+        out += " )";
+        break;
+    }
+}
+
+/* A recursive descent parser for the usual precedence:
+ *
+ * expression := term (('+' | '-') term)*
+ * term       := unary (('*' | '/') unary)*
+ * unary      := ('-' | '+') unary | power
+ * power      := primary ('^' ('2' | '3'))?
+ * primary    := number unit? | name '(' arguments ')' | name | '(' expression ')'
+ */
+class __FormulaParser
+{
+private:
+    Formula& m_formula;
+    const Str& m_text;
+    std::size_t m_pos = 0;
+
+    struct Function
+    {
+        const char* name;
+        GraphOp op;
+        int arity;
+    };
+
+    static const Function* findFunction(const Str& name)
+    {
+        static const Function functions[] = {
+            {"abs", GraphOp::Abs, 1},   {"sqrt", GraphOp::Sqrt, 1},
+            {"sqr", GraphOp::Sqr, 1},   {"cube", GraphOp::Cube, 1},
+            {"cos", GraphOp::Cos, 1},   {"sin", GraphOp::Sin, 1},
+            {"tan", GraphOp::Tan, 1},   {"acos", GraphOp::ACos, 1},
+            {"asin", GraphOp::ASin, 1}, {"atan", GraphOp::ATan, 1},
+            {"atan2", GraphOp::ATan2, 2},
+        };
+        Str lower;
+        for (char c : name)
+            lower += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        for (auto& f : functions)
+            if (lower == f.name)
+                return &f;
+        return nullptr;
+    }
+
+    [[noreturn]] void fail(const Str& what, std::size_t pos)
+    {
+        Str s = what + " at ";
+        append2str(s, static_cast<Integer>(pos));
+        throw FormulaError{s, pos};
+    }
+
+    void skip()
+    {
+        while (m_pos < m_text.size() && isspace(static_cast<unsigned char>(m_text[m_pos])))
+            m_pos++;
+    }
+
+    bool accept(char c)
+    {
+        skip();
+        if (m_pos < m_text.size() && m_text[m_pos] == c)
+        {
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c)
+    {
+        if (!accept(c))
+            fail(Str{"Expected '"} + c + "'", m_pos);
+    }
+
+    bool atName() const
+    {
+        return m_pos < m_text.size()
+            && (isalpha(static_cast<unsigned char>(m_text[m_pos])) || m_text[m_pos] == '_');
+    }
+
+    Str name()
+    {
+        std::size_t start = m_pos;
+        while (m_pos < m_text.size()
+               && (isalnum(static_cast<unsigned char>(m_text[m_pos])) || m_text[m_pos] == '_'))
+            m_pos++;
+        return m_text.substr(start, m_pos - start);
+    }
+
+    /* Dimension errors are reported at the operator that caused them */
+    std::uint32_t apply(GraphOp op, std::uint32_t a, std::uint32_t b, std::size_t pos)
+    {
+        try
+        {
+            return m_formula.apply(op, a, b);
+        }
+        catch (const FormulaError& e)
+        {
+            if (e.position() != FormulaError::npos)
+                throw;
+            fail(e.what(), pos);
+        }
+    }
+
+    std::uint32_t expression()
+    {
+        auto n = term();
+        for (;;)
+        {
+            skip();
+            std::size_t pos = m_pos;
+            if (accept('+'))
+                n = apply(GraphOp::Add, n, term(), pos);
+            else if (accept('-'))
+                n = apply(GraphOp::Sub, n, term(), pos);
+            else
+                return n;
+        }
+    }
+
+    std::uint32_t term()
+    {
+        auto n = unary();
+        for (;;)
+        {
+            skip();
+            std::size_t pos = m_pos;
+            if (accept('*'))
+                n = apply(GraphOp::Mul, n, unary(), pos);
+            else if (accept('/'))
+                n = apply(GraphOp::Div, n, unary(), pos);
+            else
+                return n;
+        }
+    }
+
+    std::uint32_t unary()
+    {
+        skip();
+        std::size_t pos = m_pos;
+        if (accept('-'))
+            return apply(GraphOp::Neg, unary(), 0, pos);
+        if (accept('+'))
+            return unary();
+        return power();
+    }
+
+    std::uint32_t power()
+    {
+        auto n = primary();
+        skip();
+        std::size_t pos = m_pos;
+        if (!accept('^'))
+            return n;
+        skip();
+        if (accept('2'))
+            return apply(GraphOp::Sqr, n, 0, pos);
+        if (accept('3'))
+            return apply(GraphOp::Cube, n, 0, pos);
+        fail("Only powers of 2 and 3 are supported", m_pos);
+    }
+
+    std::uint32_t number()
+    {
+        Real value = 0.0;
+        auto begin = m_text.data() + m_pos;
+        auto result = std::from_chars(begin, m_text.data() + m_text.size(), value);
+        if (result.ec != std::errc{})
+            fail("Bad number", m_pos);
+        m_pos += result.ptr - begin;
+
+        /* A unit right after a number belongs to it */
+        skip();
+        std::size_t start = m_pos;
+        if (atName())
+        {
+            if (auto unit = FindFormulaUnit(name()))
+                return m_formula.constant(value * unit->scale, unit->dim);
+            m_pos = start;
+        }
+        return m_formula.constant(value);
+    }
+
+    std::uint32_t primary()
+    {
+        skip();
+        if (m_pos >= m_text.size())
+            fail("Unexpected end", m_pos);
+
+        char c = m_text[m_pos];
+        if (isdigit(static_cast<unsigned char>(c)) || c == '.')
+            return number();
+
+        if (accept('('))
+        {
+            auto n = expression();
+            expect(')');
+            return n;
+        }
+
+        if (!atName())
+            fail(Str{"Unexpected '"} + c + "'", m_pos);
+
+        std::size_t pos = m_pos;
+        Str id = name();
+        if (accept('('))
+        {
+            auto f = findFunction(id);
+            if (!f)
+                fail("Unknown function " + id, pos);
+            auto a = expression();
+            std::uint32_t b = 0;
+            if (f->arity == 2)
+            {
+                expect(',');
+                b = expression();
+            }
+            expect(')');
+            return apply(f->op, a, b, pos);
+        }
+
+        auto input = m_formula.findInput(id);
+        if (input == Formula::npos)
+        {
+            if (FindFormulaUnit(id))
+                fail("Unit " + id + " needs a number before it", pos);
+            fail("Unknown name " + id, pos);
+        }
+        return m_formula.inputNode(input);
+    }
+
+public:
+    __FormulaParser(Formula& formula, const Str& text) : m_formula{formula}, m_text{text} {}
+
+    std::uint32_t parse()
+    {
+        auto n = expression();
+        skip();
+        if (m_pos < m_text.size())
+            fail(Str{"Unexpected '"} + m_text[m_pos] + "'", m_pos);
+        return n;
+    }
+};
+
+void Formula::parse(const Str& text)
+{
+    setRoot(__FormulaParser{*this, text}.parse());
+}
+
+
+/* Thread pool */
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    std::size_t count = threads > 0 ? threads : 1;
+    for (std::size_t q = 0 ; q < count ; q++)
+        m_queues.push_back(std::make_unique<Queue>());
+    for (std::size_t q = 1 ; q < count ; q++)
+        m_threads.emplace_back([this, q] { work(q); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_lock};
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+bool ThreadPool::pop(std::size_t self, std::size_t& task)
+{
+    {
+        auto& own = *m_queues[self];
+        std::lock_guard<std::mutex> lock{own.lock};
+        if (!own.tasks.empty())
+        {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    for (std::size_t k = 1 ; k < m_queues.size() ; k++)
+    {
+        auto& victim = *m_queues[(self + k) % m_queues.size()];
+        std::lock_guard<std::mutex> lock{victim.lock};
+        if (!victim.tasks.empty())
+        {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::drain(std::size_t self)
+{
+    std::size_t task;
+    while (pop(self, task))
+    {
+        (*m_task)(task);
+        if (--m_pending == 0)
+        {
+            std::lock_guard<std::mutex> lock{m_lock};
+            m_done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::work(std::size_t self)
+{
+    std::uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock{m_lock};
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop)
+                return;
+            seen = m_generation;
+        }
+        drain(self);
+    }
+}
+
+void ThreadPool::run(std::size_t count, const std::function<void(std::size_t)>& task)
+{
+    if (count == 0)
+        return;
+
+    std::lock_guard<std::mutex> running{m_runLock};
+    m_task = &task;
+    m_pending = count;
+    std::size_t queues = m_queues.size();
+    for (std::size_t q = 0 ; q < queues ; q++)
+    {
+        std::lock_guard<std::mutex> lock{m_queues[q]->lock};
+        for (std::size_t i = q * count / queues ; i < (q + 1) * count / queues ; i++)
+            m_queues[q]->tasks.push_back(i);
+    }
+    {
+        std::lock_guard<std::mutex> lock{m_lock};
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    drain(0);
+    std::unique_lock<std::mutex> lock{m_lock};
+    m_done.wait(lock, [&] { return m_pending == 0; });
+}
+
+/* Expression batches */
+
+/* Runs are cut so that there are several for each thread, which leaves
+ * room for stealing, but not so small that taking them costs more than
+ * running them.
+ */
+void ExpressionBatch::plan(std::size_t threads)
+{
+    if (!m_runs.empty() && m_runsFor == threads)
+        return;
+
+    std::size_t total = 0;
+    for (auto cost : m_costs)
+        total += cost;
+    std::size_t target = std::max<std::size_t>(total / (threads * 8), 256);
+
+    m_runs.clear();
+    m_runs.push_back(0);
+    std::size_t cost = 0;
+    for (std::size_t i = 0 ; i < m_costs.size() ; i++)
+    {
+        cost += m_costs[i];
+        if (cost >= target)
+        {
+            m_runs.push_back(i + 1);
+            cost = 0;
+        }
+    }
+    if (m_runs.back() != m_costs.size())
+        m_runs.push_back(m_costs.size());
+    m_runsFor = threads;
+}
+
+/* A buffer that a reader still holds can't be written */
+BatchSnapshot& ExpressionBatch::back()
+{
+    if (!m_back || m_back.use_count() > 1)
+        m_back = std::make_shared<BatchSnapshot>();
+    m_back->m_values.resize(m_tapes.size());
+    return *m_back;
+}
+
+void ExpressionBatch::evaluateRun(std::size_t run)
+{
+    Real* values = m_back->m_values.data();
+    for (std::size_t i = m_runs[run] ; i < m_runs[run + 1] ; i++)
+    {
+        m_tapes[i].sync();
+        values[i] = m_tapes[i].run();
+    }
+}
+
+void ExpressionBatch::evaluate(ThreadPool& pool)
+{
+    back();
+    plan(pool.threads());
+    pool.run(m_runs.size() - 1, [this](std::size_t run) { evaluateRun(run); });
+}
+
+void ExpressionBatch::evaluate()
+{
+    auto& values = back().m_values;
+    for (std::size_t i = 0 ; i < m_tapes.size() ; i++)
+    {
+        m_tapes[i].sync();
+        values[i] = m_tapes[i].run();
+    }
+}
+
+void ExpressionBatch::commit()
+{
+    if (!m_back)
+        return;
+    m_back = std::atomic_exchange(&m_front, m_back);
+}
+
+/* ODE integrators */
+
+void OdeCode::link()
+{
+    m_slots.clear();
+    m_offsets.clear();
+    m_registers = 0;
+    for (auto& tape : m_tapes)
+    {
+        for (auto var : m_states)
+            m_slots.push_back(tape.findSlot(var));
+        m_slots.push_back(tape.findSlot(m_time));
+        m_offsets.push_back(m_registers);
+        m_registers += tape.registers();
+    }
+    assert(m_slots.size() == m_states.size() * (m_states.size() + 1));
+}
+
+std::size_t OdeCode::findState(const void* var) const
+{
+    for (std::size_t s = 0 ; s < m_states.size() ; s++)
+        if (m_states[s] == var)
+            return s;
+    return npos;
+}
+
+void OdeCode::prepare(OdeLanes& lanes, std::size_t count) const
+{
+    lanes.lanes = count;
+    lanes.regs.resize(m_registers * BatchLanes);
+    lanes.y.assign(m_states.size() * BatchLanes, 0.0);
+    for (std::size_t j = 0 ; j < m_tapes.size() ; j++)
+    {
+        Real* regs = lanes.regs.data() + m_offsets[j] * BatchLanes;
+        for (std::size_t r = 0 ; r < m_tapes[j].registers() ; r++)
+            SimdFill(regs + r * BatchLanes, m_tapes[j].regs()[r], BatchLanes);
+    }
+}
+
+void OdeCode::bind(OdeLanes& lanes, const void* var, const Real* values) const
+{
+    for (std::size_t j = 0 ; j < m_tapes.size() ; j++)
+    {
+        auto reg = m_tapes[j].findSlot(var);
+        if (reg == TapeCode::npos)
+            continue;
+        Real* dst = lanes.regs.data() + (m_offsets[j] + reg) * BatchLanes;
+        std::copy(values, values + lanes.lanes, dst);
+    }
+}
+
+/* The rates of all the states at the given states and times. Rates are
+ * scaled into the raw unit of their state per raw unit of time.
+ */
+void OdeCode::rates(OdeLanes& lanes, const Real* y, const Real* t, Real* k) const
+{
+    std::size_t count = m_states.size();
+    std::size_t n = lanes.lanes;
+    for (std::size_t j = 0 ; j < m_tapes.size() ; j++)
+    {
+        Real* regs = lanes.regs.data() + m_offsets[j] * BatchLanes;
+        const std::uint32_t* slots = m_slots.data() + j * (count + 1);
+        for (std::size_t s = 0 ; s < count ; s++)
+            if (slots[s] != TapeCode::npos)
+                std::copy(y + s * BatchLanes, y + s * BatchLanes + n, regs + slots[s] * BatchLanes);
+        if (slots[count] != TapeCode::npos)
+            std::copy(t, t + n, regs + slots[count] * BatchLanes);
+        TapeRunLanes(m_tapes[j], regs, n);
+        SimdScale(k + j * BatchLanes, regs + m_tapes[j].result() * BatchLanes, m_scales[j], n);
+    }
+}
+
+void OdeCode::rk4(OdeLanes& lanes, Real t0, Real dt, std::size_t steps) const
+{
+    std::size_t count = m_states.size();
+    std::size_t n = lanes.lanes;
+    std::size_t size = count * BatchLanes;
+    std::vector<Real> k1(size), k2(size), k3(size), k4(size), tmp(size);
+    Real t[BatchLanes];
+    Real* y = lanes.y.data();
+
+    for (std::size_t step = 0 ; step < steps ; step++)
+    {
+        Real start = t0 + step * dt;
+
+        SimdFill(t, start, n);
+        rates(lanes, y, t, k1.data());
+        for (std::size_t s = 0 ; s < size ; s += BatchLanes)
+            SimdAxpy(tmp.data() + s, y + s, k1.data() + s, dt / 2, n);
+
+        SimdFill(t, start + dt / 2, n);
+        rates(lanes, tmp.data(), t, k2.data());
+        for (std::size_t s = 0 ; s < size ; s += BatchLanes)
+            SimdAxpy(tmp.data() + s, y + s, k2.data() + s, dt / 2, n);
+
+        rates(lanes, tmp.data(), t, k3.data());
+        for (std::size_t s = 0 ; s < size ; s += BatchLanes)
+            SimdAxpy(tmp.data() + s, y + s, k3.data() + s, dt, n);
+
+        SimdFill(t, start + dt, n);
+        rates(lanes, tmp.data(), t, k4.data());
+        for (std::size_t s = 0 ; s < size ; s += BatchLanes)
+        {
+            SimdAxpy(y + s, y + s, k1.data() + s, dt / 6, n);
+            SimdAxpy(y + s, y + s, k2.data() + s, dt / 3, n);
+            SimdAxpy(y + s, y + s, k3.data() + s, dt / 3, n);
+            SimdAxpy(y + s, y + s, k4.data() + s, dt / 6, n);
+        }
+    }
+}
+
+/* The Dormand-Prince tableau. The last row is also the 5th order
+ * solution, and its rate is the first one of the next step.
+ */
+static constexpr Real ___dpC[7] = {0, 1.0/5, 3.0/10, 4.0/5, 8.0/9, 1, 1};
+static constexpr Real ___dpA[7][6] = {
+    {},
+    {1.0/5},
+    {3.0/40, 9.0/40},
+    {44.0/45, -56.0/15, 32.0/9},
+    {19372.0/6561, -25360.0/2187, 64448.0/6561, -212.0/729},
+    {9017.0/3168, -355.0/33, 46732.0/5247, 49.0/176, -5103.0/18656},
+    {35.0/384, 0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84}
+};
+/* The difference between the 5th and 4th order weights */
+static constexpr Real ___dpE[7] = {
+    71.0/57600, 0, -71.0/16695, 71.0/1920, -17253.0/339200, 22.0/525, -1.0/40
+};
+
+std::size_t OdeCode::rk45(OdeLanes& lanes, Real t0, Real duration, Real tol) const
+{
+    std::size_t count = m_states.size();
+    std::size_t n = lanes.lanes;
+    std::size_t size = count * BatchLanes;
+    std::vector<Real> k(7 * size), tmp(size);
+    Real t[BatchLanes], h[BatchLanes], step[BatchLanes], at[BatchLanes];
+    bool active[BatchLanes];
+    Real* y = lanes.y.data();
+    Real end = t0 + duration;
+
+    assert(duration >= 0);
+    std::size_t remaining = 0, finished = 0;
+    for (std::size_t i = 0 ; i < n ; i++)
+    {
+        t[i] = t0;
+        h[i] = duration / 100;
+        active[i] = duration > 0;
+        remaining += active[i];
+    }
+    if (duration == 0)
+        return n;
+
+    rates(lanes, y, t, k.data());
+    for (std::size_t attempt = 0 ; remaining && attempt < MaxSteps ; attempt++)
+    {
+        /* Lanes that are done take empty steps */
+        for (std::size_t i = 0 ; i < n ; i++)
+            step[i] = active[i] ? std::min(h[i], end - t[i]) : 0.0;
+
+        for (std::size_t stage = 1 ; stage < 7 ; stage++)
+        {
+            for (std::size_t s = 0 ; s < size ; s += BatchLanes)
+            {
+                for (std::size_t i = 0 ; i < n ; i++)
+                {
+                    Real sum = 0;
+                    for (std::size_t j = 0 ; j < stage ; j++)
+                        sum += ___dpA[stage][j] * k[j * size + s + i];
+                    tmp[s + i] = y[s + i] + step[i] * sum;
+                }
+            }
+            for (std::size_t i = 0 ; i < n ; i++)
+                at[i] = t[i] + ___dpC[stage] * step[i];
+            rates(lanes, tmp.data(), at, k.data() + stage * size);
+        }
+
+        for (std::size_t i = 0 ; i < n ; i++)
+        {
+            if (!active[i])
+                continue;
+
+            Real norm = 0;
+            for (std::size_t s = 0 ; s < size ; s += BatchLanes)
+            {
+                Real err = 0;
+                for (std::size_t j = 0 ; j < 7 ; j++)
+                    err += ___dpE[j] * k[j * size + s + i];
+                err *= step[i];
+                Real scale = tol * (1 + std::max(fabs(y[s + i]), fabs(tmp[s + i])));
+                norm += (err / scale) * (err / scale);
+            }
+            norm = sqrt(norm / count);
+
+            if (norm <= 1)
+            {
+                bool last = step[i] >= end - t[i];
+                t[i] = last ? end : t[i] + step[i];
+                for (std::size_t s = 0 ; s < size ; s += BatchLanes)
+                {
+                    y[s + i] = tmp[s + i];
+                    k[s + i] = k[6 * size + s + i];
+                }
+                if (last)
+                {
+                    active[i] = false;
+                    remaining--;
+                    finished++;
+                    continue;
+                }
+            }
+
+            Real factor = (norm == 0) ? 5.0 : std::clamp(0.9 * pow(norm, -0.2), 0.2, 5.0);
+            h[i] = step[i] * factor;
+            if (!(h[i] > 1e-14 * (fabs(t[i]) + duration)))
+            {
+                active[i] = false;
+                remaining--;
+            }
+        }
+    }
+
+    return finished;
 }
 
 } // namespace frogs
@@ -7,6 +7,19 @@
 #include "frogs_matrix.h"
 #include "frogs_expressions.h"
 #include "frogs_diff.h"
+#include "frogs_tape.h"
+#include "frogs_poly.h"
+#include "frogs_batch.h"
+#include "frogs_array.h"
+#include "frogs_parallel.h"
+#include "frogs_gradient.h"
+#include "frogs_incremental.h"
+#include "frogs_dual.h"
+#include "frogs_interval.h"
+#include "frogs_solve.h"
+#include "frogs_integrate.h"
+#include "frogs_ode.h"
+#include "frogs_graph.h"
 #include "frogs_geom.h"
 
 #endif // _FROGS_H
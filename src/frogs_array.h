@@ -0,0 +1,375 @@
+#ifndef _FROGS_ARRAY_H
+#define _FROGS_ARRAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <new>
+#include <initializer_list>
+#include <utility>
+#include <cassert>
+#include <type_traits>
+
+#include "frogs_tape.h"
+#include "frogs_simd.h"
+
+namespace frogs
+{
+
+/* Buffers that start on a cache line, so that no vector load of the
+ * kernels straddles two of them.
+ */
+template<typename T>
+struct __AlignedAllocator
+{
+    using value_type = T;
+    static constexpr std::size_t Alignment = 64;
+
+    __AlignedAllocator() = default;
+    template<typename U> constexpr __AlignedAllocator(const __AlignedAllocator<U>&) {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{Alignment}));
+    }
+
+    void deallocate(T* p, std::size_t) { ::operator delete(p, std::align_val_t{Alignment}); }
+
+    template<typename U> bool operator==(const __AlignedAllocator<U>&) const { return true; }
+    template<typename U> bool operator!=(const __AlignedAllocator<U>&) const { return false; }
+};
+
+/* The scalar a value is kept in */
+template<typename T, typename = void>
+struct __ArrayScalar { using type = Real; };
+
+template<typename T>
+struct __ArrayScalar<T, std::enable_if_t<std::is_arithmetic_v<T>>> { using type = T; };
+
+template<int P, template<int...> class C, typename S>
+struct __ArrayScalar<Unit<P,C,S>> { using type = S; };
+
+/* A contiguous array of values of one type, kept as their raw Reals. The
+ * type is still checked, but arithmetic on whole arrays runs as one
+ * vector kernel instead of an operator call for each element:
+ *
+ * UnitArray<Mass> m(1000000, 2_kg);
+ * UnitArray<Acceleration> a(1000000, 9.8_mps2);
+ * UnitArray<Force> f = m * a;          // the same conversion as Mass * Acceleration
+ * Force total = Sum(f);
+ *
+ * The conversion between types is worked out once, from one unit of
+ * each, and applied to the whole array as a single factor. Sizes have
+ * to match. Comparisons give one byte for each element, 1 where they
+ * hold.
+ *
+ * The kernels work on Reals, so the values have to be kept in Reals too.
+ * Units in a float would take twice their size here, which defeats the
+ * point of them, so they're turned down. A std::vector keeps them at
+ * their own size.
+ */
+template<typename T>
+class UnitArray
+{
+    static_assert(RawTraits<T>::supported, "UnitArray needs a type with a raw value");
+    static_assert(std::is_same_v<typename __ArrayScalar<T>::type, Real>,
+                  "UnitArray keeps Reals, its type has to be kept in a Real");
+
+private:
+    std::vector<Real, __AlignedAllocator<Real>> m_raw;
+
+public:
+    using Self = UnitArray<T>;
+    using value_type = T;
+
+    /* An element, read and written through its raw value */
+    class Ref
+    {
+    private:
+        Real* m_p;
+
+    public:
+        constexpr Ref(Real* p) : m_p{p} {}
+        operator T() const { return RawTraits<T>::from(*m_p); }
+        Ref& operator=(T v) { *m_p = RawTraits<T>::raw(v); return *this; }
+        Ref& operator=(const Ref& other) { *m_p = *other.m_p; return *this; }
+    };
+
+    UnitArray() = default;
+    explicit UnitArray(std::size_t n, T v = Zero(T{})) : m_raw(n, RawTraits<T>::raw(v)) {}
+
+    UnitArray(std::initializer_list<T> values)
+    {
+        m_raw.reserve(values.size());
+        for (auto v : values)
+            m_raw.push_back(RawTraits<T>::raw(v));
+    }
+
+    template<class Container, typename = decltype(std::declval<const Container&>().size())>
+    explicit UnitArray(const Container& values)
+    {
+        m_raw.reserve(values.size());
+        for (T v : values)
+            m_raw.push_back(RawTraits<T>::raw(v));
+    }
+
+    std::size_t size() const { return m_raw.size(); }
+    bool empty() const { return m_raw.empty(); }
+    void resize(std::size_t n, T v = Zero(T{})) { m_raw.resize(n, RawTraits<T>::raw(v)); }
+    void reserve(std::size_t n) { m_raw.reserve(n); }
+    void push_back(T v) { m_raw.push_back(RawTraits<T>::raw(v)); }
+
+    /* The raw values */
+    Real* data() { return m_raw.data(); }
+    const Real* data() const { return m_raw.data(); }
+
+    /* Only arrays that outlive the expression hand out references */
+    T operator[](std::size_t i) const & { assert(i < size()); return RawTraits<T>::from(m_raw[i]); }
+    Ref operator[](std::size_t i) & { assert(i < size()); return {&m_raw[i]}; }
+
+    Self& operator+=(const Self& b)
+    {
+        assert(b.size() == size());
+        SimdAdd(data(), data(), b.data(), size());
+        return *this;
+    }
+
+    Self& operator-=(const Self& b)
+    {
+        assert(b.size() == size());
+        SimdSub(data(), data(), b.data(), size());
+        return *this;
+    }
+
+    Self& operator+=(T v) { SimdShift(data(), data(), RawTraits<T>::raw(v), size()); return *this; }
+    Self& operator-=(T v) { SimdShift(data(), data(), -RawTraits<T>::raw(v), size()); return *this; }
+    Self& operator*=(Real k) { SimdScale(data(), data(), k, size()); return *this; }
+    Self& operator/=(Real k) { SimdUnscale(data(), data(), k, size()); return *this; }
+
+    void appendTo(Str& out) const
+    {
+        out += '[';
+        for (std::size_t i = 0 ; i < size() ; i++)
+        {
+            if (i)
+                out += ", ";
+            append2str(out, (*this)[i]);
+        }
+        out += ']';
+    }
+
+    Str toString() const { Str s; appendTo(s); return s; }
+
+    friend std::ostream &operator<<(std::ostream &output, const UnitArray& obj)
+    {
+        return __Print(output, obj);
+    }
+};
+
+/* The raw factor of a conversion between types, from one unit of each */
+template<typename R, typename U>
+inline void __ScaleArray(UnitArray<R>& r, U unit)
+{
+    Real k = RawTraits<R>::raw(unit);
+    if (k != 1.0)
+        r *= k;
+}
+
+template<typename T>
+using __IfArrayScalar = std::enable_if_t<RawTraits<T>::supported && !std::is_arithmetic_v<T>>;
+
+template<typename T>
+UnitArray<T> operator-(const UnitArray<T>& a)
+{
+    UnitArray<T> r(a.size());
+    SimdNeg(r.data(), a.data(), 0.0, a.size());
+    return r;
+}
+
+template<typename T>
+UnitArray<T> operator+(const UnitArray<T>& a, const UnitArray<T>& b)
+{
+    assert(a.size() == b.size());
+    UnitArray<T> r(a.size());
+    SimdAdd(r.data(), a.data(), b.data(), a.size());
+    return r;
+}
+
+template<typename T>
+UnitArray<T> operator-(const UnitArray<T>& a, const UnitArray<T>& b)
+{
+    assert(a.size() == b.size());
+    UnitArray<T> r(a.size());
+    SimdSub(r.data(), a.data(), b.data(), a.size());
+    return r;
+}
+
+template<typename T>
+UnitArray<T> operator+(UnitArray<T> a, T v) { return a += v; }
+
+template<typename T>
+UnitArray<T> operator+(T v, UnitArray<T> a) { return a += v; }
+
+template<typename T>
+UnitArray<T> operator-(UnitArray<T> a, T v) { return a -= v; }
+
+template<typename T>
+UnitArray<T> operator*(UnitArray<T> a, Real k) { return a *= k; }
+
+template<typename T>
+UnitArray<T> operator*(Real k, UnitArray<T> a) { return a *= k; }
+
+template<typename T>
+UnitArray<T> operator/(UnitArray<T> a, Real k) { return a /= k; }
+
+/* Products and quotients of two arrays, or of an array and one value,
+ * have the type the elements would have.
+ */
+template<typename A, typename B>
+auto operator*(const UnitArray<A>& a, const UnitArray<B>& b)
+{
+    assert(a.size() == b.size());
+    auto unit = RawTraits<A>::unit() * RawTraits<B>::unit();
+    UnitArray<decltype(unit)> r(a.size());
+    SimdMul(r.data(), a.data(), b.data(), a.size());
+    __ScaleArray(r, unit);
+    return r;
+}
+
+template<typename A, typename B>
+auto operator/(const UnitArray<A>& a, const UnitArray<B>& b)
+{
+    assert(a.size() == b.size());
+    auto unit = RawTraits<A>::unit() / RawTraits<B>::unit();
+    UnitArray<decltype(unit)> r(a.size());
+    SimdDiv(r.data(), a.data(), b.data(), a.size());
+    __ScaleArray(r, unit);
+    return r;
+}
+
+template<typename A, typename B, typename = __IfArrayScalar<B>>
+auto operator*(const UnitArray<A>& a, B b)
+{
+    auto unit = RawTraits<A>::unit() * RawTraits<B>::unit();
+    UnitArray<decltype(unit)> r(a.size());
+    SimdScale(r.data(), a.data(), RawTraits<decltype(unit)>::raw(unit) * RawTraits<B>::raw(b), a.size());
+    return r;
+}
+
+template<typename A, typename B, typename = __IfArrayScalar<A>>
+auto operator*(A a, const UnitArray<B>& b)
+{
+    auto unit = RawTraits<A>::unit() * RawTraits<B>::unit();
+    UnitArray<decltype(unit)> r(b.size());
+    SimdScale(r.data(), b.data(), RawTraits<decltype(unit)>::raw(unit) * RawTraits<A>::raw(a), b.size());
+    return r;
+}
+
+template<typename A, typename B, typename = __IfArrayScalar<B>>
+auto operator/(const UnitArray<A>& a, B b)
+{
+    auto unit = RawTraits<A>::unit() / RawTraits<B>::unit();
+    UnitArray<decltype(unit)> r(a.size());
+    SimdUnscale(r.data(), a.data(), RawTraits<B>::raw(b), a.size());
+    __ScaleArray(r, unit);
+    return r;
+}
+
+#define DECL_ARRAY_COMPARISON(Opr) \
+template<typename T> \
+std::vector<std::uint8_t> operator Opr(const UnitArray<T>& a, const UnitArray<T>& b) \
+{ \
+    assert(a.size() == b.size()); \
+    std::vector<std::uint8_t> r(a.size()); \
+    const Real* pa = a.data(); \
+    const Real* pb = b.data(); \
+    for (std::size_t i = 0 ; i < r.size() ; i++) \
+        r[i] = pa[i] Opr pb[i]; \
+    return r; \
+} \
+template<typename T> \
+std::vector<std::uint8_t> operator Opr(const UnitArray<T>& a, T v) \
+{ \
+    std::vector<std::uint8_t> r(a.size()); \
+    const Real* pa = a.data(); \
+    const Real b = RawTraits<T>::raw(v); \
+    for (std::size_t i = 0 ; i < r.size() ; i++) \
+        r[i] = pa[i] Opr b; \
+    return r; \
+}
+
+DECL_ARRAY_COMPARISON(==)
+DECL_ARRAY_COMPARISON(!=)
+DECL_ARRAY_COMPARISON(<)
+DECL_ARRAY_COMPARISON(<=)
+DECL_ARRAY_COMPARISON(>)
+DECL_ARRAY_COMPARISON(>=)
+
+#undef DECL_ARRAY_COMPARISON
+
+template<typename T>
+UnitArray<T> Abs(const UnitArray<T>& a)
+{
+    UnitArray<T> r(a.size());
+    SimdAbs(r.data(), a.data(), 0.0, a.size());
+    return r;
+}
+
+template<typename T>
+auto Sqr(const UnitArray<T>& a)
+{
+    auto unit = Sqr(RawTraits<T>::unit());
+    UnitArray<decltype(unit)> r(a.size());
+    SimdSqr(r.data(), a.data(), 0.0, a.size());
+    __ScaleArray(r, unit);
+    return r;
+}
+
+template<typename T>
+auto Sqrt(const UnitArray<T>& a)
+{
+    auto unit = Sqrt(RawTraits<T>::unit());
+    UnitArray<decltype(unit)> r(a.size());
+    SimdSqrt(r.data(), a.data(), 0.0, a.size());
+    __ScaleArray(r, unit);
+    return r;
+}
+
+/* Reductions over the whole array */
+
+template<typename T>
+T Sum(const UnitArray<T>& a) { return RawTraits<T>::from(SimdSum(a.data(), a.size())); }
+
+template<typename T>
+T Mean(const UnitArray<T>& a)
+{
+    assert(!a.empty());
+    return RawTraits<T>::from(SimdSum(a.data(), a.size()) / a.size());
+}
+
+template<typename T>
+T Min(const UnitArray<T>& a)
+{
+    assert(!a.empty());
+    return RawTraits<T>::from(SimdMin(a.data(), a.size()));
+}
+
+template<typename T>
+T Max(const UnitArray<T>& a)
+{
+    assert(!a.empty());
+    return RawTraits<T>::from(SimdMax(a.data(), a.size()));
+}
+
+template<typename A, typename B>
+auto Dot(const UnitArray<A>& a, const UnitArray<B>& b)
+{
+    assert(a.size() == b.size());
+    auto unit = RawTraits<A>::unit() * RawTraits<B>::unit();
+    using R = decltype(unit);
+    return RawTraits<R>::from(SimdDot(a.data(), b.data(), a.size()) * RawTraits<R>::raw(unit));
+}
+
+} // namespace frogs
+
+#endif // _FROGS_ARRAY_H
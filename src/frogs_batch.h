@@ -0,0 +1,137 @@
+#ifndef _FROGS_BATCH_H
+#define _FROGS_BATCH_H
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include "frogs_tape.h"
+#include "frogs_simd.h"
+
+namespace frogs
+{
+
+/* Batched evaluation runs a compiled expression over whole arrays of
+ * variable values at once. The register file is widened so that every
+ * register holds a block of lanes, and each instruction of the tape
+ * runs as one vector kernel over the block.
+ */
+
+constexpr std::size_t BatchLanes = 128;
+
+/* An array of values that a variable takes across the batch */
+template<typename T>
+struct BatchInput
+{
+    Var<T>* var;
+    const T* data;
+    std::size_t size;
+};
+
+template<typename T>
+BatchInput<T> Bind(Var<T>& var, const T* data, std::size_t size)
+{
+    return {&var, data, size};
+}
+
+template<typename T, class Container>
+BatchInput<T> Bind(Var<T>& var, const Container& values)
+{
+    return {&var, values.data(), values.size()};
+}
+
+/* Runs the tape over n lanes of a widened register file */
+inline void TapeRunLanes(const TapeCode& tape, Real* regs, std::size_t n)
+{
+    for (auto& i : tape.code())
+    {
+        Real* dst = regs + i.dst * BatchLanes;
+        const Real* a = regs + i.a * BatchLanes;
+        const Real* b = regs + i.b * BatchLanes;
+        switch (i.op)
+        {
+        case TapeOp::Add:   SimdAdd(dst, a, b, n); break;
+        case TapeOp::Sub:   SimdSub(dst, a, b, n); break;
+        case TapeOp::Mul:   SimdMul(dst, a, b, n); break;
+        case TapeOp::Div:   SimdDiv(dst, a, b, n); break;
+        case TapeOp::Scale: SimdScale(dst, a, i.k, n); break;
+        case TapeOp::Neg:   SimdNeg(dst, a, i.k, n); break;
+        case TapeOp::Abs:   SimdAbs(dst, a, i.k, n); break;
+        case TapeOp::Sqrt:  SimdSqrt(dst, a, i.k, n); break;
+        case TapeOp::Sqr:   SimdSqr(dst, a, i.k, n); break;
+        case TapeOp::Cube:  SimdCube(dst, a, i.k, n); break;
+        case TapeOp::Cos:   SimdCos(dst, a, i.k, n); break;
+        case TapeOp::Sin:   SimdSin(dst, a, i.k, n); break;
+        case TapeOp::Tan:   SimdTan(dst, a, i.k, n); break;
+        case TapeOp::ACos:  SimdACos(dst, a, i.k, n); break;
+        case TapeOp::ASin:  SimdASin(dst, a, i.k, n); break;
+        case TapeOp::ATan:  SimdATan(dst, a, i.k, n); break;
+        case TapeOp::ATan2: SimdATan2(dst, a, b, n); break;
+        }
+    }
+}
+
+template<typename T>
+void __LoadLanes(const TapeCode& tape, Real* regs, BatchInput<T>& input, std::size_t offset, std::size_t n)
+{
+    auto reg = tape.findSlot(input.var);
+    if (reg == TapeCode::npos)
+        return;
+    Real* dst = regs + reg * BatchLanes;
+    for (std::size_t i = 0 ; i < n ; i++)
+        dst[i] = RawTraits<T>::raw(input.data[offset + i]);
+}
+
+/* Evaluates an expression (or an already compiled tape) for n different
+ * sets of values. Variables that aren't bound keep their current value
+ * across the whole batch.
+ */
+template<typename Exp, typename R, typename... Ts>
+void EvaluateBatch(Exp&& expr, R* out, std::size_t n, BatchInput<Ts>... inputs)
+{
+    auto&& tape = __TapeOf(expr);
+    static_assert(std::is_same_v<R, ValueOf<std::remove_reference_t<decltype(tape)>>>,
+                  "Output type doesn't match the type of the expression");
+    assert(((inputs.size >= n) && ...));
+
+    tape.sync();
+    std::vector<Real> regs(tape.registers() * BatchLanes);
+    for (std::size_t r = 0 ; r < tape.registers() ; r++)
+        SimdFill(regs.data() + r * BatchLanes, tape.regs()[r], BatchLanes);
+
+    const Real* result = regs.data() + tape.result() * BatchLanes;
+    for (std::size_t offset = 0 ; offset < n ; offset += BatchLanes)
+    {
+        std::size_t lanes = std::min(BatchLanes, n - offset);
+        (__LoadLanes(tape, regs.data(), inputs, offset, lanes), ...);
+        TapeRunLanes(tape, regs.data(), lanes);
+        for (std::size_t i = 0 ; i < lanes ; i++)
+            out[offset + i] = RawTraits<R>::from(result[i]);
+    }
+}
+
+template<typename Exp, class Out, typename... Ts>
+void EvaluateBatch(Exp&& expr, Out& out, BatchInput<Ts>... inputs)
+{
+    EvaluateBatch(expr, out.data(), out.size(), inputs...);
+}
+
+/* The single variable forms */
+
+template<typename Exp, typename T, typename R>
+void EvaluateBatch(Exp&& expr, Var<T>& var, const T* in, R* out, std::size_t n)
+{
+    EvaluateBatch(expr, out, n, Bind(var, in, n));
+}
+
+template<typename Exp, typename T, class In, class Out>
+void EvaluateBatch(Exp&& expr, Var<T>& var, const In& in, Out& out)
+{
+    assert(in.size() == out.size());
+    EvaluateBatch(expr, out.data(), out.size(), Bind(var, in));
+}
+
+} // namespace frogs
+
+#endif // _FROGS_BATCH_H
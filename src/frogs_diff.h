@@ -3,6 +3,7 @@
 
 #include <utility>
 #include <cassert>
+#include <type_traits>
 #include "frogs_expressions.h"
 
 namespace frogs
@@ -15,24 +16,34 @@ namespace frogs
  * to one or a constant and it resolves to zero.
  */
 
-/* The simplest Differentiation rules. Variables become one and
- * constants become zero.
+/* The simplest Differentiation rules. The variable we differentiate by
+ * becomes one and constants become zero. Other variables are held fixed,
+ * so they become zero as well and the result is a partial derivative.
  */
 
+template<typename T, typename DT>
+constexpr auto __Diff(Var<T>* expr, Var<DT>& dt)
+{
+    if constexpr (std::is_same_v<T, DT>)
+        return Const{(expr == &dt) ? One(T{}) : Zero(T{})};
+    else
+        return ZeroExp<T>{};
+}
+
 template<typename T, typename DT>
 constexpr auto __Diff(Var<T>& expr, Var<DT>& dt)
 {
-    /* Only one variable is supported in differentiation now */
-    assert(&dt == &expr);
-    return Const{One(T{})};
+    return __Diff(&expr, dt);
 }
 
+/* A substituted variable is a constant */
 template<typename T, typename DT>
-constexpr auto __Diff(Var<T>* expr, Var<DT>& dt)
+constexpr auto __Diff(SubstExp<T> expr, Var<DT>& dt)
 {
-    /* Only one variable is supported in differentiation now */
-    assert(&dt == expr);
-    return Const{One(T{})};
+    if constexpr (std::is_same_v<T, DT>)
+        return Const{(!expr.bound() && expr.var() == &dt) ? One(T{}) : Zero(T{})};
+    else
+        return ZeroExp<T>{};
 }
 
 template<typename T>
@@ -118,13 +129,13 @@ constexpr auto __Diff(Div<A0,A1> expr, Var<DT>& dt)
 /* Trignometry rules in Differentiation.
  *
  * if f(x) = Cos(g(x))
- * then f`(x) = Sin(g(x)) * g`(x)
+ * then f`(x) = -Sin(g(x)) * g`(x)
  * 
  * if f(x) = Sin(g(x))
- * then f`(x) = -Cos(g(x)) * g`(x)
+ * then f`(x) = Cos(g(x)) * g`(x)
  * 
  * if f(x) = Tan(g(x))
- * then f`(x) = g`(x) / (Cos(g(x)) * Cos(g(x)))
+ * then f`(x) = g`(x) / Cos(g(x))^2
  * 
  * if f(x) = ASin(g(x))
  * then f`(x) = g`(x) / Sqrt(1 - g(x) * g(x))
@@ -139,19 +150,19 @@ constexpr auto __Diff(Div<A0,A1> expr, Var<DT>& dt)
 template<typename Exp, typename DT>
 constexpr auto __Diff(CosExp<Exp,DummyClass> expr, Var<DT>& dt)
 {
-    return (Sin(Same(expr.arg())) * __Diff(expr.arg(),dt));
+    return (-Sin(Same(expr.arg())) * __Diff(expr.arg(),dt));
 }
 
 template<typename Exp, typename DT>
 constexpr auto __Diff(SinExp<Exp,DummyClass> expr, Var<DT>& dt)
 {
-    return (-Cos(Same(expr.arg())) * __Diff(expr.arg(),dt));
+    return (Cos(Same(expr.arg())) * __Diff(expr.arg(),dt));
 }
 
 template<typename Exp, typename DT>
 constexpr auto __Diff(TanExp<Exp,DummyClass> expr, Var<DT>& dt)
 {
-    return (__Diff(expr.arg(),dt) / (Cos(Same(expr.arg())) * Cos(Same(expr.arg()))));
+    return (__Diff(expr.arg(),dt) / Sqr(Cos(Same(expr.arg()))));
 }
 
 /* 
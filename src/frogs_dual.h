@@ -0,0 +1,206 @@
+#ifndef _FROGS_DUAL_H
+#define _FROGS_DUAL_H
+
+#include <type_traits>
+#include <math.h>
+
+#include "frogs_primitives.h"
+#include "frogs_physical_types.h"
+#include "frogs_expressions.h"
+
+namespace frogs
+{
+
+/* A dual number carries a value along with its differential, which is
+ * how much the value changes for one unit of change in the variable
+ * that was seeded. Using it as the value of a Var makes every
+ * expression compute its derivative in the same traversal that
+ * computes its value, without building a Diff expression.
+ *
+ * auto t = Var{Seed(0_sec), "t"};
+ * auto distance = 0.2_mps2*t*t + 10_mps*t + 20_m;
+ * auto d = $(distance);                // d.value() is a Distance
+ * auto velocity = Derivative(d, t);    // and this is a Velocity
+ *
+ * The differential has the same type as the value, just like the one
+ * that __Diff produces before Diff divides by the unit of the variable.
+ */
+template<typename T>
+class Dual
+{
+private:
+    T m_val;
+    T m_diff;
+
+public:
+    constexpr Dual() : m_val{}, m_diff{} {}
+    constexpr Dual(T v) : m_val{v}, m_diff{} {}
+    constexpr Dual(T v, T d) : m_val{v}, m_diff{d} {}
+
+    constexpr T value() const { return m_val; }
+    constexpr T diff() const { return m_diff; }
+
+    constexpr Dual& operator+=(Dual a) { m_val += a.m_val; m_diff += a.m_diff; return *this; }
+    constexpr Dual& operator-=(Dual a) { m_val -= a.m_val; m_diff -= a.m_diff; return *this; }
+    constexpr Dual& operator*=(Real a) { m_val *= a; m_diff *= a; return *this; }
+    constexpr Dual& operator/=(Real a) { m_val /= a; m_diff /= a; return *this; }
+
+    void appendTo(Str& out) const
+    {
+        out += '(';
+        append2str(out, m_val);
+        out += " +d ";
+        append2str(out, m_diff);
+        out += ')';
+    }
+
+    Str toString() const { Str s; appendTo(s); return s; }
+
+    friend std::ostream &operator<<(std::ostream &output, const Dual& obj)
+    {
+        return __Print(output, obj);
+    }
+};
+
+template<typename T> Dual(T) -> Dual<T>;
+
+/* Makes the dual value of the variable that we differentiate by */
+template<typename T>
+constexpr Dual<T> Seed(T v) { return {v, One(T{})}; }
+
+/* The derivative of a result with respect to the seeded variable */
+template<typename T, typename DT>
+constexpr auto Derivative(Dual<T> v, Var<Dual<DT>>&)
+{
+    return v.diff() / One(DT{});
+}
+
+template<typename T> struct IsDualT : std::false_type {};
+template<typename T> struct IsDualT<Dual<T>> : std::true_type {};
+
+/* Plain values are the ones that are neither duals nor expressions. They
+ * act as constants whose differential is zero.
+ */
+template<typename T>
+using IfPlain = std::enable_if_t<!IsDualT<T>::value && !IsExpr<T>>;
+
+/* Arithmetic rules, the same ones Diff uses */
+
+template<typename A, typename B>
+constexpr auto operator+(Dual<A> a, Dual<B> b) -> Dual<decltype(a.value() + b.value())>
+{ return {a.value() + b.value(), a.diff() + b.diff()}; }
+
+template<typename A, typename B>
+constexpr auto operator-(Dual<A> a, Dual<B> b) -> Dual<decltype(a.value() - b.value())>
+{ return {a.value() - b.value(), a.diff() - b.diff()}; }
+
+template<typename A, typename B>
+constexpr auto operator*(Dual<A> a, Dual<B> b) -> Dual<decltype(a.value() * b.value())>
+{ return {a.value() * b.value(), a.diff() * b.value() + a.value() * b.diff()}; }
+
+template<typename A, typename B>
+constexpr auto operator/(Dual<A> a, Dual<B> b) -> Dual<decltype(a.value() / b.value())>
+{
+    return {a.value() / b.value(),
+            (a.diff() * b.value() - a.value() * b.diff()) / (b.value() * b.value())};
+}
+
+template<typename A, typename B, typename = IfPlain<B>>
+constexpr auto operator+(Dual<A> a, B b) -> Dual<decltype(a.value() + b)>
+{ return {a.value() + b, a.diff()}; }
+
+template<typename A, typename B, typename = IfPlain<A>>
+constexpr auto operator+(A a, Dual<B> b) -> Dual<decltype(a + b.value())>
+{ return {a + b.value(), b.diff()}; }
+
+template<typename A, typename B, typename = IfPlain<B>>
+constexpr auto operator-(Dual<A> a, B b) -> Dual<decltype(a.value() - b)>
+{ return {a.value() - b, a.diff()}; }
+
+template<typename A, typename B, typename = IfPlain<A>>
+constexpr auto operator-(A a, Dual<B> b) -> Dual<decltype(a - b.value())>
+{ return {a - b.value(), -b.diff()}; }
+
+template<typename A, typename B, typename = IfPlain<B>>
+constexpr auto operator*(Dual<A> a, B b) -> Dual<decltype(a.value() * b)>
+{ return {a.value() * b, a.diff() * b}; }
+
+template<typename A, typename B, typename = IfPlain<A>>
+constexpr auto operator*(A a, Dual<B> b) -> Dual<decltype(a * b.value())>
+{ return {a * b.value(), a * b.diff()}; }
+
+template<typename A, typename B, typename = IfPlain<B>>
+constexpr auto operator/(Dual<A> a, B b) -> Dual<decltype(a.value() / b)>
+{ return {a.value() / b, a.diff() / b}; }
+
+template<typename A, typename B, typename = IfPlain<A>>
+constexpr auto operator/(A a, Dual<B> b) -> Dual<decltype(a / b.value())>
+{ return {a / b.value(), -(a * b.diff()) / (b.value() * b.value())}; }
+
+template<typename T>
+constexpr Dual<T> operator-(Dual<T> a) { return {-a.value(), -a.diff()}; }
+
+template<typename T>
+constexpr Dual<T> operator+(Dual<T> a) { return a; }
+
+/* Comparisons only look at the values */
+
+template<typename T> constexpr bool operator==(Dual<T> a, Dual<T> b) { return a.value() == b.value(); }
+template<typename T> constexpr bool operator!=(Dual<T> a, Dual<T> b) { return a.value() != b.value(); }
+template<typename T> constexpr bool operator<(Dual<T> a, Dual<T> b) { return a.value() < b.value(); }
+template<typename T> constexpr bool operator>(Dual<T> a, Dual<T> b) { return a.value() > b.value(); }
+template<typename T> constexpr bool operator<=(Dual<T> a, Dual<T> b) { return a.value() <= b.value(); }
+template<typename T> constexpr bool operator>=(Dual<T> a, Dual<T> b) { return a.value() >= b.value(); }
+
+/* Functions. The trigonometric ones use the differential of the angle
+ * in radians, so the differential of a cosine is a plain number.
+ */
+
+template<typename T>
+constexpr auto Abs(Dual<T> v) -> Dual<decltype(Abs(v.value()))>
+{ return (v.value() < T{}) ? -v : v; }
+
+template<typename T>
+constexpr auto Sqrt(Dual<T> v) -> Dual<decltype(Sqrt(v.value()))>
+{
+    auto root = Sqrt(v.value());
+    return {root, v.diff() / (2.0 * root)};
+}
+
+template<typename T>
+constexpr auto Sqr(Dual<T> v) -> Dual<decltype(Sqr(v.value()))>
+{ return {Sqr(v.value()), 2.0 * (v.value() * v.diff())}; }
+
+template<typename T>
+constexpr auto Cube(Dual<T> v) -> Dual<decltype(Cube(v.value()))>
+{ return {Cube(v.value()), 3.0 * (Sqr(v.value()) * v.diff())}; }
+
+inline Dual<Real> Cos(Dual<Angle> v)
+{ return {Cos(v.value()), -Sin(v.value()) * (v.diff() / Angle::unit())}; }
+
+inline Dual<Real> Sin(Dual<Angle> v)
+{ return {Sin(v.value()), Cos(v.value()) * (v.diff() / Angle::unit())}; }
+
+inline Dual<Real> Tan(Dual<Angle> v)
+{ return {Tan(v.value()), (v.diff() / Angle::unit()) / Sqr(Cos(v.value()))}; }
+
+inline Dual<Angle> ACos(Dual<Real> v)
+{ return {ACos(v.value()), (-v.diff() / sqrt(1.0 - Sqr(v.value()))) * Angle::unit()}; }
+
+inline Dual<Angle> ASin(Dual<Real> v)
+{ return {ASin(v.value()), (v.diff() / sqrt(1.0 - Sqr(v.value()))) * Angle::unit()}; }
+
+inline Dual<Angle> ATan(Dual<Real> v)
+{ return {ATan(v.value()), (v.diff() / (1.0 + Sqr(v.value()))) * Angle::unit()}; }
+
+template<typename T>
+constexpr auto ATan2(Dual<T> y, Dual<T> x) -> Dual<decltype(ATan2(y.value(), x.value()))>
+{
+    auto len2 = x.value() * x.value() + y.value() * y.value();
+    Real d = (x.value() * y.diff() - y.value() * x.diff()) / len2;
+    return {ATan2(y.value(), x.value()), d * Angle::unit()};
+}
+
+} // namespace frogs
+
+#endif // _FROGS_DUAL_H
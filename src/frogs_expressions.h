@@ -3,6 +3,9 @@
 
 #include <string>
 #include <set>
+#include <type_traits>
+#include <cstdint>
+#include <memory>
 #include <math.h>
 
 #include "frogs_primitives.h"
@@ -12,40 +15,69 @@ namespace frogs
 
 class DummyClass {};
 
+/* The base of the expression nodes. It's given the node class itself
+ * so that it has no virtual functions: a node is only as big as its
+ * operands, and evaluating it can be inlined or done at compile time.
+ * Each node has its own base, so an operand stored first in a node
+ * never shares a base with it and no padding is added.
+ */
+template<class Derived>
 class Expr
 {
-protected:
-    virtual void read(void* v) = 0;
-
 public:
-    template<typename T> T val() { T v; read(&v); return v; }
-    virtual Str toString() const = 0;
+    Str toString() const
+    {
+        Str s;
+        static_cast<const Derived*>(this)->appendTo(s);
+        return s;
+    }
 };
 
-extern Integer ___numVars;
+template<class T>
+constexpr bool IsExpr = std::is_base_of_v<Expr<T>, T>;
+
+/* The operators below are templates on any class with two template
+ * arguments. This makes sure they only apply to expressions and don't
+ * catch things like the iterators of the standard containers.
+ */
+template<class... Exps>
+using IfExpr = std::enable_if_t<(IsExpr<Exps> && ...)>;
+
+/* Variables are identified by a number. Names are interned in a table
+ * that's only used for printing, so unnamed variables never allocate.
+ * These are safe to call from several threads at once.
+ */
+std::uint32_t __NewVarId();
+std::uint32_t __InternName(const Str& name);
+Str __VarName(std::uint32_t id, std::uint32_t name);
+void __AppendVarName(Str& out, std::uint32_t id, std::uint32_t name);
 
 template<typename T>
-class Var : public Expr
+class Var : public Expr<Var<T>>
 {
 protected:
     T m_val;
-    Str m_name;
-
-    virtual void read(void* v) { *reinterpret_cast<T*>(v) = val(); }
+    std::uint32_t m_id;
+    std::uint32_t m_name = 0;
+    std::uint64_t m_version = 0;
 
 public:
-    Var(T v) : m_val{v}
-    {
-        m_name = "var" + std::to_string(++___numVars);
-    }
+    Var(T v) : m_val{v}, m_id{__NewVarId()} {}
+
+    Var(T v, const Str& name) : m_val{v}, m_id{__NewVarId()}, m_name{__InternName(name)} {}
 
-    Var(T v, Str name) : m_val{v}, m_name{name} {}
+    /* A copy is a variable of its own, and assigning one only writes the
+     * value. Either way the id stays unique and the version counts every
+     * write.
+     */
+    Var(const Var<T>& other) : m_val{other.m_val}, m_id{__NewVarId()}, m_name{other.m_name} {}
 
-    Var<T>& operator=(T v)      { m_val =  v; return *this; }
-    Var<T>& operator+=(T v)     { m_val += v; return *this; }
-    Var<T>& operator-=(T v)     { m_val -= v; return *this; }
-    Var<T>& operator*=(Real v)  { m_val *= v; return *this; }
-    Var<T>& operator/=(Real v)  { m_val /= v; return *this; }
+    Var<T>& operator=(const Var<T>& other) { m_val = other.m_val; ++m_version; return *this; }
+    Var<T>& operator=(T v)      { m_val =  v; ++m_version; return *this; }
+    Var<T>& operator+=(T v)     { m_val += v; ++m_version; return *this; }
+    Var<T>& operator-=(T v)     { m_val -= v; ++m_version; return *this; }
+    Var<T>& operator*=(Real v)  { m_val *= v; ++m_version; return *this; }
+    Var<T>& operator/=(Real v)  { m_val /= v; ++m_version; return *this; }
 
     bool operator<(T v)  { return m_val < v; }
     bool operator>(T v)  { return m_val > v; }
@@ -54,31 +86,34 @@ public:
     bool operator==(T v) { return m_val == v; }
     bool operator!=(T v) { return m_val != v; }
 
-    Str name() { return m_name; }
+    Str name() const { return __VarName(m_id, m_name); }
+    std::uint32_t id() const { return m_id; }
+
+    /* Counts the writes to the variable, so cached results know when
+     * they're stale.
+     */
+    std::uint64_t version() const { return m_version; }
 
-    constexpr T val() { return m_val; }
+    constexpr T val() const { return m_val; }
 
     friend std::ostream &operator<<(std::ostream &output, const Var<T>& obj)
     {
-        output << obj.toString();
-        return output;
+        return __Print(output, obj);
     }
 
     friend std::ostream &operator<<(std::ostream &output, const Var<T>* obj)
     {
-        output << obj->toString();
-        return output;
+        return __Print(output, *obj);
     }
 
     friend std::ostream &operator<<(std::ostream &output, const Var<T>&& obj)
     {
-        output << obj.toString();
-        return output;
+        return __Print(output, obj);
     }
 
-    virtual Str toString() const
+    void appendTo(Str& out) const
     {
-        return m_name;
+        __AppendVarName(out, m_id, m_name);
     }
 };
 
@@ -91,67 +126,59 @@ auto Replace(Var<T>* exp, Var<VT>& var)
 template<typename VT>
 auto Replace(Var<VT>* exp, Var<VT>& var)
 {
-    if (exp->name() == var.name())
+    if (exp->id() == var.id())
         return &var;
     else
         return exp;
 }
 
+/* The number of nodes in the expression tree. Subtrees that appear more
+ * than once are counted every time, so this is what $() walks through.
+ */
+template<typename T>
+constexpr Integer NodeCount(Var<T>*) { return 1; }
+
+template<typename T>
+constexpr Integer NodeCount(Var<T>&) { return 1; }
+
 template<typename T, class Dummy = DummyClass>
-class Const : public Expr
+class Const : public Expr<Const<T,Dummy>>
 {
 protected:
     T m_val;
 
-    virtual void read(void* v) { *reinterpret_cast<T*>(v) = val(); }
-
 public:
     constexpr Const(T v) : m_val{v} {}
-    constexpr T val() { return m_val; }
-    virtual Str toString() const { return conv2str(m_val); }
+    constexpr T val() const { return m_val; }
+    void appendTo(Str& out) const { append2str(out, m_val); }
 
     friend std::ostream &operator<<(std::ostream &output, Const<T> obj)
     {
-        output << obj.toString();
-        return output;
+        return __Print(output, obj);
     }
 };
 
-// template<typename T>
-// auto operator+(Const<T> a, Const<T> b)
-// { return Const{a.val() + b.val()}; }
-// template<typename T>
-// auto operator-(Const<T> a, Const<T> b)
-// { return Const{a.val() - b.val()}; }
-// template<typename T0, typename T1>
-// auto operator*(Const<T0> a, Const<T1> b)
-// { return Const{a.val() * b.val()}; }
-// template<typename T0, typename T1>
-// auto operator/(Const<T0> a, Const<T1> b)
-// { return Const{a.val() / b.val()}; }
-
 template<typename T, typename VT>
 auto Replace(Const<T> exp, Var<VT>& var)
 {
     return exp;
 }
 
+template<typename T>
+constexpr Integer NodeCount(Const<T>) { return 1; }
+
 template<typename T, class Dummy = DummyClass>
-class ZeroExp : public Expr
+class ZeroExp : public Expr<ZeroExp<T,Dummy>>
 {
-protected:
-    virtual void read(void* v) { *reinterpret_cast<T*>(v) = val(); }
-
 public:
     constexpr ZeroExp() {}
     constexpr ZeroExp(T v) {}
-    constexpr T val() { return Zero(T{}); }
-    virtual Str toString() const { return "0"; }
+    constexpr T val() const { return Zero(T{}); }
+    void appendTo(Str& out) const { out += '0'; }
 
     friend std::ostream &operator<<(std::ostream &output, ZeroExp<T> obj)
     {
-        output << obj.toString();
-        return output;
+        return __Print(output, obj);
     }
 };
 
@@ -161,6 +188,98 @@ auto Replace(ZeroExp<T> exp, Var<VT>& var)
     return exp;
 }
 
+template<typename T>
+constexpr Integer NodeCount(ZeroExp<T>) { return 1; }
+
+/* A variable that Substitute may have given a fixed value. When it has,
+ * the value is used and the variable is never read. So an expression
+ * whose variables are all substituted can be evaluated at compile time,
+ * as long as the variables have static storage.
+ */
+template<typename T, class Dummy = DummyClass>
+class SubstExp : public Expr<SubstExp<T,Dummy>>
+{
+protected:
+    Var<T>* m_var;
+    T m_val;
+    bool m_bound;
+
+public:
+    constexpr SubstExp(Var<T>* var, T v, bool bound) : m_var{var}, m_val{v}, m_bound{bound} {}
+    constexpr T val() const { return m_bound ? m_val : m_var->val(); }
+    constexpr bool bound() const { return m_bound; }
+    constexpr Var<T>* var() const { return m_var; }
+
+    void appendTo(Str& out) const
+    {
+        if (m_bound)
+            append2str(out, m_val);
+        else
+            m_var->appendTo(out);
+    }
+
+    friend std::ostream &operator<<(std::ostream &output, SubstExp<T> obj)
+    {
+        return __Print(output, obj);
+    }
+};
+
+template<typename T, typename VT>
+auto Replace(SubstExp<T> exp, Var<VT>& var)
+{
+    return SubstExp<T>{Replace(exp.var(), var), $(exp), exp.bound()};
+}
+
+template<typename T>
+constexpr Integer NodeCount(SubstExp<T>) { return 1; }
+
+/* Substitute gives a variable a fixed value in an expression. The result
+ * keeps the shape of the expression, with the variable's leaves holding
+ * the value instead.
+ */
+template<typename T, typename VT, typename V>
+constexpr auto Substitute(Var<T>* exp, Var<VT>& var, V value)
+{
+    return exp;
+}
+
+template<typename VT, typename V>
+constexpr auto Substitute(Var<VT>* exp, Var<VT>& var, V value)
+{
+    return SubstExp<VT>{exp, static_cast<VT>(value), exp == &var};
+}
+
+template<typename T, typename VT, typename V>
+constexpr auto Substitute(Var<T>& exp, Var<VT>& var, V value)
+{
+    return Substitute(&exp, var, value);
+}
+
+template<typename T, typename VT, typename V>
+constexpr auto Substitute(Const<T> exp, Var<VT>& var, V value)
+{
+    return exp;
+}
+
+template<typename T, typename VT, typename V>
+constexpr auto Substitute(ZeroExp<T> exp, Var<VT>& var, V value)
+{
+    return exp;
+}
+
+template<typename T, typename VT, typename V>
+constexpr auto Substitute(SubstExp<T> exp, Var<VT>& var, V value)
+{
+    return exp;
+}
+
+template<typename VT, typename V>
+constexpr auto Substitute(SubstExp<VT> exp, Var<VT>& var, V value)
+{
+    bool hit = !exp.bound() && exp.var() == &var;
+    return SubstExp<VT>{exp.var(), hit ? static_cast<VT>(value) : $(exp), exp.bound() || hit};
+}
+
 /* Each operator class needs to handle a combination of values and pointers.
  * And these combinations apply for each operator. Some operators operate on
  * just one argument and others operate on two. So here we'll make macros
@@ -169,23 +288,24 @@ auto Replace(ZeroExp<T> exp, Var<VT>& var)
 
 #define DECL_OPR_CLASS_1(ClassName, Func, Str1, Str2) \
 template<typename Exp, class Dummy = DummyClass> \
-class ClassName : public Expr { \
+class ClassName : public Expr<ClassName<Exp,Dummy>> { \
 protected: \
     Exp m_a; \
-    virtual void read(void* v) { *reinterpret_cast<decltype(val())*>(v) = val(); } \
 public: \
     constexpr ClassName(Exp a) : m_a{a} {} \
-    constexpr auto val() { return Func($(m_a)); } \
-    virtual Str toString() const { return Str1 + conv2str(m_a) + Str2; } \
+    constexpr auto val() const { return Func($(m_a)); } \
+    void appendTo(Str& out) const { \
+        out += Str1; \
+        append2str(out, m_a); \
+        out += Str2; \
+    } \
     friend std::ostream &operator<<(std::ostream &output, const ClassName& obj) { \
-        output << obj.toString(); \
-        return output; \
+        return __Print(output, obj); \
     } \
     friend std::ostream &operator<<(std::ostream &output, const ClassName&& obj) { \
-        output << obj.toString(); \
-        return output; \
+        return __Print(output, obj); \
     } \
-    constexpr Exp arg() { return m_a; } \
+    constexpr Exp arg() const { return m_a; } \
 }; \
 template<typename VT, typename Exp> \
 auto Replace(ClassName<Exp,DummyClass>& exp, Var<VT>& var) { \
@@ -195,30 +315,39 @@ template<typename VT, typename Exp> \
 auto Replace(ClassName<Exp,DummyClass>&& exp, Var<VT>& var) { \
     return ClassName{Replace(exp.arg(), var) }; \
 } \
+template<typename Exp, typename VT, typename V> \
+constexpr auto Substitute(ClassName<Exp,DummyClass> exp, Var<VT>& var, V value) { \
+    return ClassName{Substitute(exp.arg(), var, value)}; \
+} \
+template<typename Exp> \
+constexpr Integer NodeCount(ClassName<Exp,DummyClass> exp) { \
+    return 1 + NodeCount(exp.arg()); \
+} \
 
 #define DECL_OPR_CLASS_2(ClassName, Func, Str1, Str2, Str3) \
 template<class Exp0, class Exp1> \
-class ClassName : public Expr { \
+class ClassName : public Expr<ClassName<Exp0,Exp1>> { \
 protected: \
     Exp0 m_a; \
     Exp1 m_b; \
-    virtual void read(void* v) { *reinterpret_cast<decltype(val())*>(v) = val(); } \
 public: \
     constexpr ClassName(Exp0 a, Exp1 b) : m_a{a}, m_b{b} {} \
-    constexpr auto val() { return Func($(m_a), $(m_b)); } \
-    virtual Str toString() const { \
-        return Str1 + conv2str(m_a) + Str2 + conv2str(m_b) + Str3; \
+    constexpr auto val() const { return Func($(m_a), $(m_b)); } \
+    void appendTo(Str& out) const { \
+        out += Str1; \
+        append2str(out, m_a); \
+        out += Str2; \
+        append2str(out, m_b); \
+        out += Str3; \
     } \
     friend std::ostream &operator<<(std::ostream &output, const ClassName& obj) { \
-        output << obj.toString(); \
-        return output; \
+        return __Print(output, obj); \
     } \
     friend std::ostream &operator<<(std::ostream &output, const ClassName&& obj) { \
-        output << obj.toString(); \
-        return output; \
+        return __Print(output, obj); \
     } \
-    constexpr Exp0 first() { return m_a; } \
-    constexpr Exp1 second() { return m_b; } \
+    constexpr Exp0 first() const { return m_a; } \
+    constexpr Exp1 second() const { return m_b; } \
 }; \
 template<typename VT, class Exp0, class Exp1> \
 auto Replace(ClassName<Exp0,Exp1>& exp, Var<VT>& var) { \
@@ -230,6 +359,15 @@ auto Replace(ClassName<Exp0,Exp1>&& exp, Var<VT>& var) { \
     return ClassName{Replace(exp.first(), var), \
                      Replace(exp.second(), var)}; \
 } \
+template<class Exp0, class Exp1, typename VT, typename V> \
+constexpr auto Substitute(ClassName<Exp0,Exp1> exp, Var<VT>& var, V value) { \
+    return ClassName{Substitute(exp.first(), var, value), \
+                     Substitute(exp.second(), var, value)}; \
+} \
+template<class Exp0, class Exp1> \
+constexpr Integer NodeCount(ClassName<Exp0,Exp1> exp) { \
+    return 1 + NodeCount(exp.first()) + NodeCount(exp.second()); \
+} \
 
 #define DECL_OPR_2(Name, Opr) \
 template<typename T0, typename T1> constexpr auto Name##Func(T0 a, T1 b) { return a Opr b; } \
@@ -238,27 +376,30 @@ template<typename T0, typename T1> \
 constexpr Name<Var<T0>*, Var<T1>*> operator Opr(Var<T0>& a, Var<T1>& b) \
 { return {&a, &b}; } \
 template<typename T, typename A, typename B, \
-         template<class...> class Exp> \
+         template<class...> class Exp, \
+         typename = IfExpr<Exp<A,B>>> \
 constexpr Name<Var<T>*,Exp<A,B>> operator Opr(Var<T>& a, Exp<A,B> b) \
 { return {&a, b}; } \
 template<typename T, typename A, typename B, \
-         template<class...> class Exp> \
+         template<class...> class Exp, \
+         typename = IfExpr<Exp<A,B>>> \
 constexpr Name<Exp<A,B>,Var<T>*> operator Opr(Exp<A,B> a, Var<T>& b) \
 { return {a, &b}; } \
 template<typename A, typename B, \
          typename C, typename D, \
          template<class...> class Exp0, \
-         template<class...> class Exp1> \
+         template<class...> class Exp1, \
+         typename = IfExpr<Exp0<A,B>,Exp1<C,D>>> \
 constexpr Name<Exp0<A,B>,Exp1<C,D>> operator Opr(Exp0<A,B> a, Exp1<C,D> b) \
 { return {a, b}; } \
 template<typename A, typename B, \
          template<class...> class Exp0, \
-         typename T> \
+         typename T, typename = IfExpr<Exp0<A,B>>> \
 constexpr Name<Exp0<A,B>,Const<T,DummyClass>> operator Opr(Exp0<A,B> a, T b) \
 { return {a, Const{b}}; } \
 template<typename A, typename B, \
          template<class...> class Exp0, \
-         typename T> \
+         typename T, typename = IfExpr<Exp0<A,B>>> \
 constexpr Name<Const<T,DummyClass>,Exp0<A,B>> operator Opr(T a, Exp0<A,B> b) \
 { return {Const{a}, b}; } \
 template<typename T0, typename T1> \
@@ -274,27 +415,30 @@ template<typename T0, typename T1> \
 constexpr Name<Var<T0>*, Var<T1>*> Func(Var<T0>& a, Var<T1>& b) \
 { return {&a, &b}; } \
 template<typename T, typename A, typename B, \
-         template<class...> class Exp> \
+         template<class...> class Exp, \
+         typename = IfExpr<Exp<A,B>>> \
 constexpr Name<Var<T>*,Exp<A,B>> Func(Var<T>& a, Exp<A,B> b) \
 { return {&a, b}; } \
 template<typename T, typename A, typename B, \
-         template<class...> class Exp> \
+         template<class...> class Exp, \
+         typename = IfExpr<Exp<A,B>>> \
 constexpr Name<Exp<A,B>,Var<T>*> Func(Exp<A,B> a, Var<T>& b) \
 { return {a, &b}; } \
 template<typename A, typename B, \
          typename C, typename D, \
          template<class...> class Exp0, \
-         template<class...> class Exp1> \
+         template<class...> class Exp1, \
+         typename = IfExpr<Exp0<A,B>,Exp1<C,D>>> \
 constexpr Name<Exp0<A,B>,Exp1<C,D>> Func(Exp0<A,B> a, Exp1<C,D> b) \
 { return {a, b}; } \
 template<typename A, typename B, \
          template<class...> class Exp0, \
-         typename T> \
+         typename T, typename = IfExpr<Exp0<A,B>>> \
 constexpr Name<Exp0<A,B>,Const<T,DummyClass>> Func(Exp0<A,B> a, T b) \
 { return {a, Const{b}}; } \
 template<typename A, typename B, \
          template<class...> class Exp0, \
-         typename T> \
+         typename T, typename = IfExpr<Exp0<A,B>>> \
 constexpr Name<Const<T,DummyClass>,Exp0<A,B>> Func(T a, Exp0<A,B> b) \
 { return {Const{a}, b}; } \
 template<typename T0, typename T1> \
@@ -311,7 +455,8 @@ template<typename T> \
 constexpr Name<Var<T>*,DummyClass> operator Opr(Var<T>& a) \
 { return {&a}; } \
 template<typename A, typename B, \
-         template<class...> class Exp> \
+         template<class...> class Exp, \
+         typename = IfExpr<Exp<A,B>>> \
 constexpr Name<Exp<A,B>,DummyClass> operator Opr(Exp<A,B> a) \
 { return {a}; } \
 
@@ -321,7 +466,8 @@ template<typename T> \
 constexpr Name<Var<T>*,DummyClass> Func(Var<T>& a) \
 { return {&a}; } \
 template<typename A, typename B, \
-         template<class...> class Exp> \
+         template<class...> class Exp, \
+         typename = IfExpr<Exp<A,B>>> \
 constexpr Name<Exp<A,B>,DummyClass> Func(Exp<A,B> a) \
 { return {a}; } \
 
@@ -348,9 +494,9 @@ template<typename T0, typename T1>
 constexpr auto operator+(Var<T0>& a, ZeroExp<T1> b) { return a; }
 template<typename T0, typename T1>
 constexpr auto operator+(ZeroExp<T0> a, Var<T1>& b) { return b; }
-template<typename A, typename B, template<class...> class Exp, typename T>
+template<typename A, typename B, template<class...> class Exp, typename T, typename = IfExpr<Exp<A,B>>>
 constexpr auto operator+(Exp<A,B> a, ZeroExp<T> b) { return a; }
-template<typename A, typename B, template<class...> class Exp, typename T>
+template<typename A, typename B, template<class...> class Exp, typename T, typename = IfExpr<Exp<A,B>>>
 constexpr auto operator+(ZeroExp<T> a, Exp<A,B> b) { return b; }
 template<typename T0, typename T1>
 constexpr auto operator+(ZeroExp<T0> a, ZeroExp<T1> b) { return a; }
@@ -360,9 +506,9 @@ template<typename T0, typename T1>
 constexpr auto operator-(Var<T0>& a, ZeroExp<T1> b) { return a; }
 template<typename T0, typename T1>
 constexpr auto operator-(ZeroExp<T0> a, Var<T1>& b) { return -b; }
-template<typename A, typename B, template<class...> class Exp, typename T>
+template<typename A, typename B, template<class...> class Exp, typename T, typename = IfExpr<Exp<A,B>>>
 constexpr auto operator-(Exp<A,B> a, ZeroExp<T> b) { return a; }
-template<typename A, typename B, template<class...> class Exp, typename T>
+template<typename A, typename B, template<class...> class Exp, typename T, typename = IfExpr<Exp<A,B>>>
 constexpr auto operator-(ZeroExp<T> a, Exp<A,B> b) { return -b; }
 template<typename T0, typename T1>
 constexpr auto operator-(ZeroExp<T0> a, ZeroExp<T1> b) { return a; }
@@ -372,9 +518,9 @@ template<typename T0, typename T1>
 constexpr auto operator*(Var<T0>& a, ZeroExp<T1> b) { return b; }
 template<typename T0, typename T1>
 constexpr auto operator*(ZeroExp<T0> a, Var<T1>& b) { return a; }
-template<typename A, typename B, template<class...> class Exp, typename T>
+template<typename A, typename B, template<class...> class Exp, typename T, typename = IfExpr<Exp<A,B>>>
 constexpr auto operator*(Exp<A,B> a, ZeroExp<T> b) { return b; }
-template<typename A, typename B, template<class...> class Exp, typename T>
+template<typename A, typename B, template<class...> class Exp, typename T, typename = IfExpr<Exp<A,B>>>
 constexpr auto operator*(ZeroExp<T> a, Exp<A,B> b) { return a; }
 template<typename T0, typename T1>
 constexpr auto operator*(ZeroExp<T0> a, ZeroExp<T1> b) { return a; }
@@ -382,12 +528,97 @@ constexpr auto operator*(ZeroExp<T0> a, ZeroExp<T1> b) { return a; }
 /* Division where ZeroExp is a numerator */
 template<typename T0, typename T1>
 constexpr auto operator/(ZeroExp<T0> a, Var<T1>& b) { return a; }
-template<typename A, typename B, template<class...> class Exp, typename T>
+template<typename A, typename B, template<class...> class Exp, typename T, typename = IfExpr<Exp<A,B>>>
 constexpr auto operator/(ZeroExp<T> a, Exp<A,B> b) { return a; }
 
+/* Operations on constants fold into a single constant right away, so
+ * they never make it into the tree. Differentiation produces a lot of
+ * these, like multiplying a constant by the one of a variable.
+ */
+template<typename T0, typename T1>
+constexpr auto operator+(Const<T0> a, Const<T1> b) -> decltype(Const{a.val() + b.val()})
+{ return Const{a.val() + b.val()}; }
+template<typename T0, typename T1>
+constexpr auto operator-(Const<T0> a, Const<T1> b) -> decltype(Const{a.val() - b.val()})
+{ return Const{a.val() - b.val()}; }
+template<typename T0, typename T1>
+constexpr auto operator*(Const<T0> a, Const<T1> b) -> decltype(Const{a.val() * b.val()})
+{ return Const{a.val() * b.val()}; }
+template<typename T0, typename T1>
+constexpr auto operator/(Const<T0> a, Const<T1> b) -> decltype(Const{a.val() / b.val()})
+{ return Const{a.val() / b.val()}; }
+template<typename T>
+constexpr auto operator-(Const<T> a) -> decltype(Const{-a.val()})
+{ return Const{-a.val()}; }
+
+/* Negating twice cancels out, and so does negating zero */
+template<typename T>
+constexpr Var<T>& operator-(Neg<Var<T>*,DummyClass> a) { return *a.arg(); }
+template<typename A, typename B, template<class...> class Exp, typename = IfExpr<Exp<A,B>>>
+constexpr auto operator-(Neg<Exp<A,B>,DummyClass> a) { return a.arg(); }
+template<typename T>
+constexpr auto operator-(ZeroExp<T> a) { return a; }
+
 template<class T> constexpr auto $(T&& v) { return v.val(); }
 template<class T> constexpr auto $(T* v) { return v->val(); }
 
+/* Every expression is a different type. AnyExpr erases the type of an
+ * expression of value type T, so that different ones can be kept in the
+ * same container or member. It costs an allocation when it's made and a
+ * virtual call when it's evaluated, which is why it's only used where
+ * it's asked for. It can be combined with other expressions but it
+ * can't be differentiated or compiled.
+ */
+template<typename T, class Dummy = DummyClass>
+class AnyExpr : public Expr<AnyExpr<T,Dummy>>
+{
+private:
+    struct Concept
+    {
+        virtual ~Concept() = default;
+        virtual T val() const = 0;
+        virtual void appendTo(Str& out) const = 0;
+        virtual Integer nodes() const = 0;
+    };
+
+    template<class Exp>
+    struct Model : Concept
+    {
+        Exp m_exp;
+        Model(Exp exp) : m_exp{exp} {}
+        T val() const override { return $(m_exp); }
+        void appendTo(Str& out) const override { append2str(out, m_exp); }
+        Integer nodes() const override { return NodeCount(m_exp); }
+    };
+
+    std::shared_ptr<const Concept> m_impl;
+
+public:
+    template<class Exp, typename = IfExpr<Exp>,
+             typename = std::enable_if_t<!std::is_same_v<Exp, AnyExpr>>>
+    AnyExpr(Exp exp) : m_impl{std::make_shared<Model<Exp>>(exp)} {}
+
+    AnyExpr(Var<T>& var) : m_impl{std::make_shared<Model<Var<T>*>>(&var)} {}
+
+    T val() const { return m_impl->val(); }
+    void appendTo(Str& out) const { m_impl->appendTo(out); }
+    Integer nodes() const { return m_impl->nodes(); }
+
+    friend std::ostream &operator<<(std::ostream &output, const AnyExpr& obj)
+    {
+        return __Print(output, obj);
+    }
+};
+
+template<class Exp, typename = IfExpr<Exp>>
+AnyExpr(Exp) -> AnyExpr<std::decay_t<decltype($(std::declval<Exp&>()))>>;
+
+template<typename T>
+AnyExpr(Var<T>&) -> AnyExpr<T>;
+
+template<typename T>
+Integer NodeCount(AnyExpr<T> exp) { return exp.nodes(); }
+
 } // namespace frogs
 
 #endif // _FROGS_EXPRESSIONS_H
@@ -0,0 +1,142 @@
+#ifndef _FROGS_FIXED_H
+#define _FROGS_FIXED_H
+
+#include <cassert>
+#include <cstdint>
+#include <ratio>
+#include <limits>
+#include <type_traits>
+#include <math.h>
+
+#include "frogs_primitives.h"
+
+namespace frogs
+{
+
+/* A number kept as an integer count of a fixed step, where the step is
+ * a std::ratio. It's what units keep their value in when it has to be
+ * exact, like timestamps in nanoseconds:
+ *
+ * using TimeNs = Unit<1,TimeT,Fixed<std::int64_t,std::nano>>;
+ * TimeNs t{1.5_msec};                 // 1500000 steps of 1 ns
+ * t += TimeNs{1_nsec};                // exact, no drift
+ *
+ * Adding, subtracting and comparing two of them is done on the counts,
+ * so it's exact and as cheap as it is for integers. Scaling by a Real
+ * rounds to the nearest step. A product or a quotient of two of them,
+ * and the roots, are Reals, since they don't have the same step.
+ * Converting from and to Reals, or to another step, is explicit.
+ * Tapes, batches and UnitArrays work on Reals, so they don't take units
+ * in a Fixed.
+ */
+template<typename R, class Ratio>
+class Fixed
+{
+    static_assert(std::is_integral_v<R> && std::is_signed_v<R>, "Fixed counts in a signed integer");
+
+private:
+    R m_count;
+
+    /* Converting a value that doesn't fit in R, or a NaN, is undefined */
+    static constexpr R round(Real v)
+    {
+        Real r = v < 0 ? v - 0.5 : v + 0.5;
+        assert(r >= static_cast<Real>(std::numeric_limits<R>::min()) &&
+               r < -static_cast<Real>(std::numeric_limits<R>::min()));
+        return static_cast<R>(r);
+    }
+
+public:
+    using Self = Fixed<R,Ratio>;
+    using Count = R;
+    using Step = Ratio;
+
+    constexpr Fixed() : m_count{0} {}
+    explicit constexpr Fixed(Real v) : m_count{round(v * Ratio::den / Ratio::num)} {}
+
+    /* From another step. It's exact when this step divides the other */
+    template<typename F, class FRatio>
+    explicit constexpr Fixed(Fixed<F,FRatio> v) : m_count{0}
+    {
+        using Factor = std::ratio_divide<FRatio, Ratio>;
+        if constexpr (Factor::den == 1)
+            m_count = static_cast<R>(v.count() * Factor::num);
+        else
+            m_count = round(static_cast<Real>(v.count()) * Factor::num / Factor::den);
+    }
+
+    static constexpr Self fromCount(R count) { Self v; v.m_count = count; return v; }
+    constexpr R count() const { return m_count; }
+
+    explicit constexpr operator Real() const { return static_cast<Real>(m_count) * Ratio::num / Ratio::den; }
+
+    constexpr Self& operator+=(Self a) { m_count += a.m_count; return *this; }
+    constexpr Self& operator-=(Self a) { m_count -= a.m_count; return *this; }
+
+    void appendTo(Str& out) const { append2str(out, static_cast<Real>(*this)); }
+    Str toString() const { Str s; appendTo(s); return s; }
+
+    friend std::ostream &operator<<(std::ostream &output, const Fixed& obj)
+    {
+        return __Print(output, obj);
+    }
+};
+
+#define FIXED_TEMPLATE template<typename R, class Ratio>
+#define FIXED_TYPE Fixed<R,Ratio>
+
+FIXED_TEMPLATE constexpr FIXED_TYPE operator+(FIXED_TYPE a) { return a; }
+FIXED_TEMPLATE constexpr FIXED_TYPE operator-(FIXED_TYPE a) { return FIXED_TYPE::fromCount(-a.count()); }
+FIXED_TEMPLATE constexpr FIXED_TYPE operator+(FIXED_TYPE a, FIXED_TYPE b) { return FIXED_TYPE::fromCount(a.count() + b.count()); }
+FIXED_TEMPLATE constexpr FIXED_TYPE operator-(FIXED_TYPE a, FIXED_TYPE b) { return FIXED_TYPE::fromCount(a.count() - b.count()); }
+FIXED_TEMPLATE constexpr FIXED_TYPE operator*(FIXED_TYPE a, Real b) { return FIXED_TYPE{static_cast<Real>(a) * b}; }
+FIXED_TEMPLATE constexpr FIXED_TYPE operator*(Real a, FIXED_TYPE b) { return FIXED_TYPE{a * static_cast<Real>(b)}; }
+FIXED_TEMPLATE constexpr FIXED_TYPE operator/(FIXED_TYPE a, Real b) { return FIXED_TYPE{static_cast<Real>(a) / b}; }
+FIXED_TEMPLATE constexpr Real operator*(FIXED_TYPE a, FIXED_TYPE b) { return static_cast<Real>(a) * static_cast<Real>(b); }
+FIXED_TEMPLATE constexpr Real operator/(FIXED_TYPE a, FIXED_TYPE b) { return static_cast<Real>(a.count()) / b.count(); }
+
+FIXED_TEMPLATE constexpr bool operator==(FIXED_TYPE a, FIXED_TYPE b) { return a.count() == b.count(); }
+FIXED_TEMPLATE constexpr bool operator!=(FIXED_TYPE a, FIXED_TYPE b) { return a.count() != b.count(); }
+FIXED_TEMPLATE constexpr bool operator<(FIXED_TYPE a, FIXED_TYPE b) { return a.count() < b.count(); }
+FIXED_TEMPLATE constexpr bool operator<=(FIXED_TYPE a, FIXED_TYPE b) { return a.count() <= b.count(); }
+FIXED_TEMPLATE constexpr bool operator>(FIXED_TYPE a, FIXED_TYPE b) { return a.count() > b.count(); }
+FIXED_TEMPLATE constexpr bool operator>=(FIXED_TYPE a, FIXED_TYPE b) { return a.count() >= b.count(); }
+
+FIXED_TEMPLATE constexpr FIXED_TYPE Abs(FIXED_TYPE v) { return v.count() < 0 ? -v : v; }
+FIXED_TEMPLATE constexpr Real Sqrt(FIXED_TYPE v) { return Sqrt(static_cast<Real>(v)); }
+FIXED_TEMPLATE constexpr Real Sqr(FIXED_TYPE v) { return v * v; }
+FIXED_TEMPLATE constexpr Real Cube(FIXED_TYPE v) { return v * v * static_cast<Real>(v); }
+FIXED_TEMPLATE constexpr FIXED_TYPE One(FIXED_TYPE) { return FIXED_TYPE{1.0}; }
+FIXED_TEMPLATE constexpr FIXED_TYPE Zero(FIXED_TYPE) { return {}; }
+
+/* What units do with their scalar when it's scaled or inverted */
+FIXED_TEMPLATE constexpr FIXED_TYPE __Scale(FIXED_TYPE v, Real k) { return v * k; }
+FIXED_TEMPLATE constexpr FIXED_TYPE __Unscale(FIXED_TYPE v, Real k) { return v / k; }
+FIXED_TEMPLATE constexpr Real __Inverse(Real a, FIXED_TYPE v) { return a / static_cast<Real>(v); }
+
+#undef FIXED_TEMPLATE
+#undef FIXED_TYPE
+
+} // namespace frogs
+
+namespace std
+{
+
+template<typename R, class Ratio>
+class numeric_limits<frogs::Fixed<R,Ratio>>
+{
+public:
+    static constexpr bool is_specialized = true;
+    static constexpr bool is_signed = true;
+    static constexpr bool is_integer = false;
+    static constexpr bool is_exact = true;
+    /* Like for floating point, min() is the smallest positive value */
+    static constexpr frogs::Fixed<R,Ratio> min() { return frogs::Fixed<R,Ratio>::fromCount(1); }
+    static constexpr frogs::Fixed<R,Ratio> max() { return frogs::Fixed<R,Ratio>::fromCount(std::numeric_limits<R>::max()); }
+    static constexpr frogs::Fixed<R,Ratio> lowest() { return frogs::Fixed<R,Ratio>::fromCount(std::numeric_limits<R>::min()); }
+    static constexpr frogs::Fixed<R,Ratio> epsilon() { return frogs::Fixed<R,Ratio>::fromCount(1); }
+};
+
+} // namespace std
+
+#endif // _FROGS_FIXED_H
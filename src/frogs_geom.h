@@ -213,25 +213,24 @@ public:
     friend Shape2D operator*(Mat4&& m, Shape2D& s) { return fwd(m) * s; }
     friend Shape2D operator*(Mat4&& m, Shape2D&& s) { return fwd(m) * s; }
 
-    Str toString() const
+    void appendTo(Str& out) const
     {
-        Str s = "[ ";
+        out += "[ ";
         for (auto& pt : m_data)
-            s += conv2str(pt);
-        s += " ]";
-        return s;
+            append2str(out, pt);
+        out += " ]";
     }
 
+    Str toString() const { Str s; appendTo(s); return s; }
+
     friend std::ostream &operator<<(std::ostream &output, const Shape2D& obj)
     {
-        output << obj.toString();
-        return output;
+        return __Print(output, obj);
     }
 
     friend std::ostream &operator<<(std::ostream &output, const Shape2D&& obj)
     {
-        output << obj.toString();
-        return output;
+        return __Print(output, obj);
     }
 };
 
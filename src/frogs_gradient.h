@@ -0,0 +1,117 @@
+#ifndef _FROGS_GRADIENT_H
+#define _FROGS_GRADIENT_H
+
+#include <tuple>
+#include <vector>
+#include <math.h>
+
+#include "frogs_tape.h"
+
+namespace frogs
+{
+
+/* Reverse mode differentiation. The tape is run forward once to get the
+ * value of every register, then walked backwards once to propagate the
+ * adjoint of the result (how much it changes per unit change of each
+ * register) down to the variables. That gives the partial derivatives
+ * with respect to all the variables at the cost of about two
+ * evaluations, no matter how many variables there are.
+ */
+
+/* Propagates the adjoints backwards. The registers must hold the values
+ * of the last forward run, and adj must have room for every register.
+ */
+inline void TapeBackward(const TapeCode& tape, Real* adj)
+{
+    const Real* r = tape.regs().data();
+    auto& code = tape.code();
+    for (std::size_t n = 0 ; n < tape.registers() ; n++)
+        adj[n] = 0.0;
+    adj[tape.result()] = 1.0;
+
+    for (std::size_t n = code.size() ; n > 0 ; n--)
+    {
+        auto& i = code[n - 1];
+        Real g = adj[i.dst];
+        if (g == 0.0)
+            continue;
+        Real a = r[i.a];
+        Real b = r[i.b];
+        switch (i.op)
+        {
+        case TapeOp::Add:   adj[i.a] += g; adj[i.b] += g; break;
+        case TapeOp::Sub:   adj[i.a] += g; adj[i.b] -= g; break;
+        case TapeOp::Mul:   adj[i.a] += g * b; adj[i.b] += g * a; break;
+        case TapeOp::Div:   adj[i.a] += g / b; adj[i.b] -= g * r[i.dst] / b; break;
+        case TapeOp::Scale: adj[i.a] += g * i.k; break;
+        case TapeOp::Neg:   adj[i.a] -= g; break;
+        case TapeOp::Abs:   adj[i.a] += (a < 0) ? -g : g; break;
+        case TapeOp::Sqrt:  adj[i.a] += g / (2.0 * r[i.dst]); break;
+        case TapeOp::Sqr:   adj[i.a] += g * 2.0 * a; break;
+        case TapeOp::Cube:  adj[i.a] += g * 3.0 * a * a; break;
+        case TapeOp::Cos:   adj[i.a] -= g * sin(a); break;
+        case TapeOp::Sin:   adj[i.a] += g * cos(a); break;
+        case TapeOp::Tan:   adj[i.a] += g / (cos(a) * cos(a)); break;
+        case TapeOp::ACos:  adj[i.a] -= g / sqrt(1.0 - a * a); break;
+        case TapeOp::ASin:  adj[i.a] += g / sqrt(1.0 - a * a); break;
+        case TapeOp::ATan:  adj[i.a] += g / (1.0 + a * a); break;
+        case TapeOp::ATan2:
+        {
+            Real len2 = a * a + b * b;
+            adj[i.a] += g * b / len2;
+            adj[i.b] -= g * a / len2;
+            break;
+        }
+        }
+    }
+}
+
+/* Turns the raw adjoint of a variable into a derivative with the right
+ * units, which is the type of the result divided by the type of the
+ * variable.
+ */
+template<typename R, typename T>
+auto __Partial(const TapeCode& tape, const Real* adj, Var<T>& var)
+{
+    auto reg = tape.findSlot(&var);
+    Real raw = (reg == TapeCode::npos) ? 0.0 : adj[reg];
+    return (raw * RawTraits<R>::unit()) / RawTraits<T>::unit();
+}
+
+/* Returns a tuple with the partial derivative of the expression with
+ * respect to each variable, evaluated at their current values.
+ *
+ * auto [dfdx, dfdy] = Gradient(f, x, y);
+ */
+template<typename Exp, typename... Ts>
+auto Gradient(Exp&& expr, Var<Ts>&... vars)
+{
+    auto&& tape = __TapeOf(expr);
+    using R = ValueOf<std::remove_reference_t<decltype(tape)>>;
+    tape.val();
+    std::vector<Real> adj(tape.registers());
+    TapeBackward(tape, adj.data());
+    return std::make_tuple(__Partial<R>(tape, adj.data(), vars)...);
+}
+
+/* The same for a list of variables of the same type, which is handy
+ * when there are a lot of them.
+ */
+template<typename Exp, typename T>
+auto Gradient(Exp&& expr, const std::vector<Var<T>*>& vars)
+{
+    auto&& tape = __TapeOf(expr);
+    using R = ValueOf<std::remove_reference_t<decltype(tape)>>;
+    tape.val();
+    std::vector<Real> adj(tape.registers());
+    TapeBackward(tape, adj.data());
+    std::vector<decltype(__Partial<R>(tape, adj.data(), *vars[0]))> result;
+    result.reserve(vars.size());
+    for (auto var : vars)
+        result.push_back(__Partial<R>(tape, adj.data(), *var));
+    return result;
+}
+
+} // namespace frogs
+
+#endif // _FROGS_GRADIENT_H
@@ -0,0 +1,250 @@
+#ifndef _FROGS_GRAPH_H
+#define _FROGS_GRAPH_H
+
+#include <array>
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <stdexcept>
+#include <type_traits>
+
+#include "frogs_primitives.h"
+#include "frogs_physical_types.h"
+#include "frogs_tape.h"
+
+namespace frogs
+{
+
+/* Formulas that are only known at run time, like the ones read from a
+ * config file, can't be template expressions. They're built as a graph
+ * of nodes instead, which mirrors the expression classes, is checked
+ * for dimensions as it's built, and evaluates through a compiled tape.
+ *
+ * Formula f;
+ * auto t = f.input<Time>("t");
+ * f.parse("0.2 mps2 * t*t + 10 mps * t");
+ * f.set(t, 3_sec);
+ * Distance d = f.eval<Distance>();
+ */
+
+/* The dimension and SI factor of a value type */
+template<typename T, typename = void>
+struct DimTraits
+{
+    static constexpr bool supported = false;
+};
+
+template<typename T>
+struct DimTraits<T, std::enable_if_t<std::is_arithmetic_v<T>>>
+{
+    static constexpr bool supported = true;
+    static constexpr Dimension dim() { return {}; }
+    static constexpr Real scale() { return 1.0; }
+};
+
+template<int P, template<int...> class C>
+struct DimTraits<Unit<P,C>, std::enable_if_t<ClassDim<C>::supported>>
+{
+    static constexpr bool supported = true;
+    static constexpr Dimension dim() { return ClassDim<C>::dim.pow(P); }
+    static constexpr Real scale() { return __IntPow(ClassDim<C>::toSI, P); }
+};
+
+template<int L, int M, int T, int A, int Px>
+struct DimTraits<Quantity<L,M,T,A,Px>>
+{
+    static constexpr bool supported = true;
+    static constexpr Dimension dim() { return Quantity<L,M,T,A,Px>::dim; }
+    static constexpr Real scale() { return Quantity<L,M,T,A,Px>::unit().si(); }
+};
+
+template<typename T>
+constexpr Real ToSI(T v) { return RawTraits<T>::raw(v) * DimTraits<T>::scale(); }
+
+template<typename T>
+constexpr T FromSI(Real v) { return RawTraits<T>::from(v / DimTraits<T>::scale()); }
+
+/* Errors in building a formula, like a syntax error or adding meters to
+ * seconds. The position is where in the text it happened, if the
+ * formula was parsed.
+ */
+class FormulaError : public std::runtime_error
+{
+private:
+    std::size_t m_pos;
+
+public:
+    static constexpr std::size_t npos = ~std::size_t{0};
+
+    FormulaError(const Str& what, std::size_t pos = npos)
+        : std::runtime_error{what}, m_pos{pos} {}
+
+    std::size_t position() const { return m_pos; }
+};
+
+/* The operations of the graph are the ones of the expression classes */
+enum class GraphOp : std::uint8_t
+{
+    Const, Input,
+    Add, Sub, Mul, Div,
+    Neg, Abs, Sqrt, Sqr, Cube,
+    Cos, Sin, Tan, ACos, ASin, ATan, ATan2
+};
+
+struct GraphNode
+{
+    GraphOp op;
+    std::uint32_t a, b;
+    Real value;
+    Dimension dim;
+};
+
+/* A typed handle to one of the inputs of a formula */
+template<typename T>
+struct FormulaInput
+{
+    std::uint32_t index;
+};
+
+class Formula
+{
+protected:
+    /* An input either holds its value, in SI, or reads a variable */
+    struct Input
+    {
+        Str name;
+        Dimension dim;
+        Real scale;
+        Real value;
+        std::uint64_t version;
+        void* var;
+        Real (*read)(void*);
+        std::uint64_t (*versionOf)(void*);
+    };
+
+    std::deque<Input> m_inputs;
+    std::vector<GraphNode> m_nodes;
+    std::uint32_t m_root = npos;
+    TapeCode m_tape;
+    bool m_compiled = false;
+
+    std::uint32_t node(GraphOp op, std::uint32_t a, std::uint32_t b, Real value, Dimension dim);
+    std::uint32_t addInput(Input input);
+    void appendNode(Str& out, std::uint32_t n) const;
+    void compile();
+
+public:
+    static constexpr std::uint32_t npos = ~std::uint32_t{0};
+
+    Formula() {}
+    Formula(const Formula&) = delete;
+    Formula& operator=(const Formula&) = delete;
+
+    /* An input that holds its own value, set with set() */
+    template<typename T>
+    FormulaInput<T> input(const Str& name)
+    {
+        static_assert(DimTraits<T>::supported, "Input type has no dimension");
+        Input in{name, DimTraits<T>::dim(), 1.0, 0.0, 0, nullptr,
+                 [](void* v) { return static_cast<Input*>(v)->value; },
+                 [](void* v) { return static_cast<Input*>(v)->version; }};
+        return {addInput(in)};
+    }
+
+    /* An input that reads a variable whenever the formula is evaluated */
+    template<typename T>
+    FormulaInput<T> input(const Str& name, Var<T>& var)
+    {
+        static_assert(DimTraits<T>::supported, "Input type has no dimension");
+        Input in{name, DimTraits<T>::dim(), DimTraits<T>::scale(), 0.0, 0, &var,
+                 __VarAccess<T>::read, __VarAccess<T>::version};
+        return {addInput(in)};
+    }
+
+    std::uint32_t findInput(const Str& name) const;
+
+    template<typename T>
+    void set(FormulaInput<T> in, T v)
+    {
+        auto& input = m_inputs[in.index];
+        assert(input.var == &input);
+        input.value = ToSI(v);
+        input.version++;
+    }
+
+    /* Building the graph. Each of these returns a node, and apply()
+     * throws a FormulaError when the dimensions don't agree.
+     */
+    std::uint32_t constant(Real si, Dimension dim = {}) { return node(GraphOp::Const, 0, 0, si, dim); }
+
+    template<typename T>
+    std::uint32_t constant(T v) { return constant(ToSI(v), DimTraits<T>::dim()); }
+
+    std::uint32_t inputNode(std::uint32_t index)
+    {
+        return node(GraphOp::Input, index, 0, 0.0, m_inputs[index].dim);
+    }
+
+    std::uint32_t apply(GraphOp op, std::uint32_t a, std::uint32_t b = 0);
+
+    void setRoot(std::uint32_t n) { m_root = n; m_compiled = false; }
+
+    /* Parses a formula over the inputs declared so far. Numbers may be
+     * followed by a unit, like "10 mps" or "2.5km", and the functions
+     * have the same names as the expression ones.
+     */
+    void parse(const Str& text);
+
+    Dimension dimension() const { return m_nodes[m_root].dim; }
+    const std::vector<GraphNode>& nodes() const { return m_nodes; }
+    std::uint32_t root() const { return m_root; }
+
+    /* The compiled tape. Its result is in SI units. */
+    const TapeCode& tape()
+    {
+        if (!m_compiled)
+            compile();
+        return m_tape;
+    }
+
+    Real eval()
+    {
+        if (!m_compiled)
+            compile();
+        m_tape.sync();
+        return m_tape.run();
+    }
+
+    template<typename R>
+    R eval()
+    {
+        static_assert(DimTraits<R>::supported, "Result type has no dimension");
+        if (DimTraits<R>::dim() != dimension())
+            throw FormulaError{"Formula has dimension " + dimension().toString()
+                               + ", not " + DimTraits<R>::dim().toString()};
+        return FromSI<R>(eval());
+    }
+
+    void appendTo(Str& out) const { appendNode(out, m_root); }
+    Str toString() const { Str s; appendTo(s); return s; }
+
+    friend std::ostream &operator<<(std::ostream &output, const Formula& obj)
+    {
+        return __Print(output, obj);
+    }
+};
+
+/* Units that the parser knows, by the name of their literal suffix */
+struct FormulaUnit
+{
+    const char* name;
+    Dimension dim;
+    Real scale;
+};
+
+const FormulaUnit* FindFormulaUnit(const Str& name);
+
+} // namespace frogs
+
+#endif // _FROGS_GRAPH_H
@@ -0,0 +1,161 @@
+#ifndef _FROGS_INCREMENTAL_H
+#define _FROGS_INCREMENTAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+#include "frogs_tape.h"
+
+namespace frogs
+{
+
+/* A compiled expression that keeps the value of every instruction
+ * between evaluations. Each slot knows the instructions that depend on
+ * it, directly or not, so when a variable is written only those are run
+ * again. The rest keep the values they had.
+ *
+ * auto cached = CompileCached(expr);
+ * x = 5_m;
+ * $(cached);    // only reruns what depends on x
+ */
+template<typename R>
+class CachedTape : public Tape<R>
+{
+private:
+    using TapeCode::m_code;
+    using TapeCode::m_regs;
+    using TapeCode::m_slots;
+    using TapeCode::m_result;
+
+    /* The instructions that depend on each slot, in evaluation order */
+    std::vector<std::vector<std::uint32_t>> m_deps;
+    std::vector<std::uint64_t> m_versions;
+    std::vector<std::uint8_t> m_dirty;
+    std::vector<std::uint32_t> m_slotIndex;
+    std::vector<std::uint32_t> m_merged;
+    std::vector<std::uint32_t> m_scratch;
+    bool m_valid = false;
+    std::size_t m_work = 0;
+
+    void build()
+    {
+        std::vector<std::uint8_t> depends(m_regs.size());
+        m_slotIndex.assign(m_regs.size(), TapeCode::npos);
+        for (std::uint32_t s = 0 ; s < m_slots.size() ; s++)
+        {
+            std::fill(depends.begin(), depends.end(), 0);
+            depends[m_slots[s].reg] = 1;
+            m_slotIndex[m_slots[s].reg] = s;
+
+            std::vector<std::uint32_t> deps;
+            for (std::uint32_t n = 0 ; n < m_code.size() ; n++)
+            {
+                auto& i = m_code[n];
+                if (depends[i.a] || (TapeCode::isBinary(i.op) && depends[i.b]))
+                {
+                    depends[i.dst] = 1;
+                    deps.push_back(n);
+                }
+            }
+            m_deps.push_back(std::move(deps));
+        }
+        m_versions.assign(m_slots.size(), 0);
+        m_dirty.assign(m_slots.size(), 0);
+    }
+
+    /* The union of the instructions that depend on the dirty slots */
+    const std::vector<std::uint32_t>* pending()
+    {
+        const std::vector<std::uint32_t>* list = nullptr;
+        for (std::uint32_t s = 0 ; s < m_slots.size() ; s++)
+        {
+            if (!m_dirty[s])
+                continue;
+            m_dirty[s] = 0;
+            if (!list)
+            {
+                list = &m_deps[s];
+                continue;
+            }
+            m_scratch.clear();
+            std::set_union(list->begin(), list->end(), m_deps[s].begin(), m_deps[s].end(),
+                           std::back_inserter(m_scratch));
+            m_merged.swap(m_scratch);
+            list = &m_merged;
+        }
+        return list;
+    }
+
+public:
+    explicit CachedTape(Tape<R>&& tape) : Tape<R>(std::move(tape)) { build(); }
+
+    template<typename T>
+    void set(TapeSlot<T> slot, T v)
+    {
+        Tape<R>::set(slot, v);
+        m_dirty[m_slotIndex[slot.reg]] = 1;
+    }
+
+    /* Runs the instructions that depend on the slots changed by set() */
+    R run()
+    {
+        if (!m_valid)
+        {
+            std::fill(m_dirty.begin(), m_dirty.end(), 0);
+            m_valid = true;
+            m_work = m_code.size();
+            return Tape<R>::run();
+        }
+
+        m_work = 0;
+        if (auto list = pending())
+        {
+            Real* r = m_regs.data();
+            for (auto n : *list)
+            {
+                auto& i = m_code[n];
+                r[i.dst] = TapeApply(i.op, r[i.a], r[i.b], i.k);
+            }
+            m_work = list->size();
+        }
+        return RawTraits<R>::from(m_regs[m_result]);
+    }
+
+    /* Reads only the variables that were written since the last time */
+    R val()
+    {
+        for (std::uint32_t s = 0 ; s < m_slots.size() ; s++)
+        {
+            auto& slot = m_slots[s];
+            auto version = slot.version(slot.var);
+            if (m_valid && version == m_versions[s])
+                continue;
+            m_versions[s] = version;
+            m_regs[slot.reg] = slot.read(slot.var);
+            m_dirty[s] = 1;
+        }
+        return run();
+    }
+
+    R operator()() { return val(); }
+
+    /* Forces the next evaluation to run everything */
+    void invalidate() { m_valid = false; }
+
+    /* The number of instructions that the last evaluation ran */
+    std::size_t work() const { return m_work; }
+};
+
+template<typename Exp>
+auto CompileCached(Exp&& expr)
+{
+    using R = ValueOf<std::remove_reference_t<Exp>>;
+    return CachedTape<R>(Compile(expr));
+}
+
+} // namespace frogs
+
+#endif // _FROGS_INCREMENTAL_H
@@ -0,0 +1,185 @@
+#ifndef _FROGS_INTEGRATE_H
+#define _FROGS_INTEGRATE_H
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+#include "frogs_expressions.h"
+#include "frogs_tape.h"
+#include "frogs_batch.h"
+#include "frogs_utils.h"
+
+namespace frogs
+{
+
+/* The 15 point Gauss-Kronrod rule. The Kronrod nodes are on one side of
+ * the middle, the last one is the middle itself. The 7 point Gauss rule
+ * uses every other one of them, so the difference of both rules is an
+ * estimate of the error that costs no extra evaluations.
+ */
+constexpr Real __KronrodNodes[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.0
+};
+
+constexpr Real __KronrodWeights[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+};
+
+constexpr Real __GaussWeights[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+};
+
+constexpr std::size_t __KronrodPoints = 15;
+
+/* An integration can't be split into more pieces than this */
+constexpr std::size_t IntegrateMaxPieces = 4096;
+
+struct __QuadPiece
+{
+    Real a, b;
+    Real value = 0, error = 0, magnitude = 0;
+};
+
+/* The values of the integrand at the nodes of each piece, all of them
+ * run through the batched tape in blocks of lanes.
+ */
+inline void __QuadEvaluate(const TapeCode& tape, Real* regs, std::uint32_t slot,
+                           __QuadPiece* pieces, std::size_t count, std::vector<Real>& fx)
+{
+    std::vector<Real> xs(count * __KronrodPoints);
+    for (std::size_t p = 0 ; p < count ; p++)
+    {
+        Real c = (pieces[p].a + pieces[p].b) / 2;
+        Real h = (pieces[p].b - pieces[p].a) / 2;
+        Real* x = xs.data() + p * __KronrodPoints;
+        for (std::size_t j = 0 ; j < 7 ; j++)
+        {
+            x[2 * j] = c - h * __KronrodNodes[j];
+            x[2 * j + 1] = c + h * __KronrodNodes[j];
+        }
+        x[14] = c;
+    }
+
+    fx.resize(xs.size());
+    const Real* result = regs + tape.result() * BatchLanes;
+    for (std::size_t offset = 0 ; offset < xs.size() ; offset += BatchLanes)
+    {
+        std::size_t lanes = std::min(BatchLanes, xs.size() - offset);
+        if (slot != TapeCode::npos)
+            std::copy(xs.data() + offset, xs.data() + offset + lanes, regs + slot * BatchLanes);
+        TapeRunLanes(tape, regs, lanes);
+        std::copy(result, result + lanes, fx.data() + offset);
+    }
+
+    for (std::size_t p = 0 ; p < count ; p++)
+    {
+        const Real* f = fx.data() + p * __KronrodPoints;
+        Real h = (pieces[p].b - pieces[p].a) / 2;
+        Real kronrod = __KronrodWeights[7] * f[14];
+        Real gauss = __GaussWeights[3] * f[14];
+        Real magnitude = __KronrodWeights[7] * fabs(f[14]);
+        for (std::size_t j = 0 ; j < 7 ; j++)
+        {
+            Real sum = f[2 * j] + f[2 * j + 1];
+            kronrod += __KronrodWeights[j] * sum;
+            magnitude += __KronrodWeights[j] * (fabs(f[2 * j]) + fabs(f[2 * j + 1]));
+            if (j % 2)
+                gauss += __GaussWeights[j / 2] * sum;
+        }
+        pieces[p].value = kronrod * h;
+        pieces[p].error = fabs((kronrod - gauss) * h);
+        pieces[p].magnitude = magnitude * fabs(h);
+    }
+}
+
+/* Integrates an expression over a range of one of its variables. The
+ * result has the type of the product of both, so a velocity integrated
+ * over time gives a distance:
+ *
+ * auto t = Var{0_sec, "t"};
+ * auto v = 0.4_mps2*t + 10_mps;
+ * Distance d = Integrate(v, t, Range{0_sec, 10_sec});
+ *
+ * It's adaptive. Each piece of the range gets a 15 point Gauss-Kronrod
+ * rule, and the pieces with the largest error are halved until the
+ * total error is below tol, relative to the integral of the absolute
+ * value. All the nodes of a round go through the batched tape together.
+ * The step of the range isn't used, and the variable keeps its value.
+ */
+template<typename Exp, typename T>
+auto Integrate(Exp&& expr, Var<T>& var, Range<T> range, Real tol = 1e-10)
+{
+    auto tape = Compile(expr);
+    using R = ValueOf<decltype(tape)>;
+
+    tape.sync();
+    std::vector<Real> regs(tape.registers() * BatchLanes);
+    for (std::size_t r = 0 ; r < tape.registers() ; r++)
+        SimdFill(regs.data() + r * BatchLanes, tape.regs()[r], BatchLanes);
+    auto slot = tape.findSlot(&var);
+
+    std::vector<__QuadPiece> pieces{{RawTraits<T>::raw(range.min()), RawTraits<T>::raw(range.max())}};
+    std::vector<Real> fx;
+    __QuadEvaluate(tape, regs.data(), slot, pieces.data(), 1, fx);
+
+    std::vector<__QuadPiece> split;
+    while (true)
+    {
+        Real value = 0, error = 0, magnitude = 0;
+        for (auto& p : pieces)
+        {
+            value += p.value;
+            error += p.error;
+            magnitude += p.magnitude;
+        }
+        Real bound = tol * magnitude;
+        if (error <= bound || pieces.size() >= IntegrateMaxPieces)
+            break;
+
+        /* Halve the worst pieces, until the ones that are left would be
+         * within the bound on their own.
+         */
+        std::sort(pieces.begin(), pieces.end(),
+                  [](auto& a, auto& b) { return a.error > b.error; });
+        std::size_t worst = 0;
+        for (Real rest = error ; worst < pieces.size() && rest > bound / 2 ; worst++)
+        {
+            Real m = (pieces[worst].a + pieces[worst].b) / 2;
+            if (m == pieces[worst].a || m == pieces[worst].b)
+                break;
+            rest -= pieces[worst].error;
+        }
+        worst = std::min(worst, (IntegrateMaxPieces - pieces.size()));
+        if (worst == 0)
+            break;
+
+        split.clear();
+        for (std::size_t i = 0 ; i < worst ; i++)
+        {
+            Real m = (pieces[i].a + pieces[i].b) / 2;
+            split.push_back({pieces[i].a, m});
+            split.push_back({m, pieces[i].b});
+        }
+        __QuadEvaluate(tape, regs.data(), slot, split.data(), split.size(), fx);
+        pieces.erase(pieces.begin(), pieces.begin() + worst);
+        pieces.insert(pieces.end(), split.begin(), split.end());
+    }
+
+    Real value = 0;
+    for (auto& p : pieces)
+        value += p.value;
+    return RawTraits<R>::from(value) * RawTraits<T>::unit();
+}
+
+} // namespace frogs
+
+#endif // _FROGS_INTEGRATE_H
@@ -0,0 +1,327 @@
+#ifndef _FROGS_INTERVAL_H
+#define _FROGS_INTERVAL_H
+
+#include <limits>
+#include <utility>
+#include <type_traits>
+#include <math.h>
+
+#include "frogs_primitives.h"
+#include "frogs_physical_types.h"
+#include "frogs_expressions.h"
+#include "frogs_tape.h"
+
+namespace frogs
+{
+
+/* An interval holds every value a quantity might have, between a lower
+ * and an upper bound. Using it as the value of a Var makes an expression
+ * give bounds on its result over all of those values at once, which
+ * can rule out a whole region of parameters in one evaluation:
+ *
+ * auto t = Var{Interval{0_sec, 10_sec}, "t"};
+ * auto distance = 0.2_mps2*t*t + 10_mps*t + 20_m;
+ * auto d = $(distance);          // [20 m, 140 m], or a bit wider
+ *
+ * The bounds are always on the safe side. Each result is moved out by
+ * one unit in the last place, so rounding can't make it too tight. But
+ * they can be wider than needed when a variable appears more than once,
+ * since each appearance is taken on its own. For example, t*t over
+ * [-1, 1] gives [-1, 1] where Sqr(t) gives [0, 1].
+ */
+template<typename T>
+class Interval
+{
+private:
+    T m_lo;
+    T m_hi;
+
+public:
+    constexpr Interval() : m_lo{}, m_hi{} {}
+    constexpr Interval(T v) : m_lo{v}, m_hi{v} {}
+    constexpr Interval(T lo, T hi) : m_lo{lo}, m_hi{hi} {}
+
+    constexpr T lower() const { return m_lo; }
+    constexpr T upper() const { return m_hi; }
+    constexpr T width() const { return m_hi - m_lo; }
+    constexpr T mid() const { return m_lo + (m_hi - m_lo) / 2.0; }
+
+    constexpr bool contains(T v) const { return !(v < m_lo) && !(m_hi < v); }
+
+    /* The two halves, for branch and bound */
+    constexpr std::pair<Interval, Interval> split() const
+    {
+        T m = mid();
+        return {{m_lo, m}, {m, m_hi}};
+    }
+
+    void appendTo(Str& out) const
+    {
+        out += '[';
+        append2str(out, m_lo);
+        out += ", ";
+        append2str(out, m_hi);
+        out += ']';
+    }
+
+    Str toString() const { Str s; appendTo(s); return s; }
+
+    friend std::ostream &operator<<(std::ostream &output, const Interval& obj)
+    {
+        return __Print(output, obj);
+    }
+};
+
+template<typename T> Interval(T) -> Interval<T>;
+template<typename T> Interval(T, T) -> Interval<T>;
+
+template<typename T> struct IsIntervalT : std::false_type {};
+template<typename T> struct IsIntervalT<Interval<T>> : std::true_type {};
+
+/* Plain values act as intervals of a single value */
+template<typename T>
+using IfNotInterval = std::enable_if_t<!IsIntervalT<T>::value && !IsExpr<T>>;
+
+/* Equal when both bounds are */
+template<typename T> constexpr bool operator==(Interval<T> a, Interval<T> b)
+{ return a.lower() == b.lower() && a.upper() == b.upper(); }
+template<typename T> constexpr bool operator!=(Interval<T> a, Interval<T> b)
+{ return !(a == b); }
+
+template<typename T>
+constexpr bool Intersects(Interval<T> a, Interval<T> b)
+{ return !(a.upper() < b.lower()) && !(b.upper() < a.lower()); }
+
+/* The smallest interval that holds both */
+template<typename T>
+constexpr Interval<T> Hull(Interval<T> a, Interval<T> b)
+{
+    return {b.lower() < a.lower() ? b.lower() : a.lower(),
+            a.upper() < b.upper() ? b.upper() : a.upper()};
+}
+
+template<typename T>
+constexpr T __Lower(T a, T b) { return b < a ? b : a; }
+
+template<typename T>
+constexpr T __Upper(T a, T b) { return a < b ? b : a; }
+
+/* Moves the bounds out by one unit in the last place */
+template<typename T>
+Interval<T> __Outward(T lo, T hi)
+{
+    if constexpr (RawTraits<T>::supported && !std::is_integral_v<T>)
+    {
+        constexpr Real inf = std::numeric_limits<Real>::infinity();
+        return {RawTraits<T>::from(nextafter(RawTraits<T>::raw(lo), -inf)),
+                RawTraits<T>::from(nextafter(RawTraits<T>::raw(hi), inf))};
+    }
+    else
+        return {lo, hi};
+}
+
+template<typename T>
+Interval<T> __Everything()
+{
+    constexpr Real inf = std::numeric_limits<Real>::infinity();
+    return {-inf * One(T{}), inf * One(T{})};
+}
+
+/* Arithmetic. A product takes the extremes of the products of the
+ * bounds, and dividing by an interval that holds zero can give anything.
+ */
+
+template<typename A, typename B>
+auto operator+(Interval<A> a, Interval<B> b) -> Interval<decltype(a.lower() + b.lower())>
+{ return __Outward(a.lower() + b.lower(), a.upper() + b.upper()); }
+
+template<typename A, typename B>
+auto operator-(Interval<A> a, Interval<B> b) -> Interval<decltype(a.lower() - b.lower())>
+{ return __Outward(a.lower() - b.upper(), a.upper() - b.lower()); }
+
+template<typename A, typename B>
+auto operator*(Interval<A> a, Interval<B> b) -> Interval<decltype(a.lower() * b.lower())>
+{
+    auto p0 = a.lower() * b.lower();
+    auto p1 = a.lower() * b.upper();
+    auto p2 = a.upper() * b.lower();
+    auto p3 = a.upper() * b.upper();
+    return __Outward(__Lower(__Lower(p0, p1), __Lower(p2, p3)),
+                     __Upper(__Upper(p0, p1), __Upper(p2, p3)));
+}
+
+template<typename A, typename B>
+auto operator/(Interval<A> a, Interval<B> b) -> Interval<decltype(a.lower() / b.lower())>
+{
+    using R = decltype(a.lower() / b.lower());
+    if (b.contains(B{}))
+        return __Everything<R>();
+    auto q0 = a.lower() / b.lower();
+    auto q1 = a.lower() / b.upper();
+    auto q2 = a.upper() / b.lower();
+    auto q3 = a.upper() / b.upper();
+    return __Outward(__Lower(__Lower(q0, q1), __Lower(q2, q3)),
+                     __Upper(__Upper(q0, q1), __Upper(q2, q3)));
+}
+
+template<typename A, typename B, typename = IfNotInterval<B>>
+auto operator+(Interval<A> a, B b) { return a + Interval<B>{b}; }
+
+template<typename A, typename B, typename = IfNotInterval<A>>
+auto operator+(A a, Interval<B> b) { return Interval<A>{a} + b; }
+
+template<typename A, typename B, typename = IfNotInterval<B>>
+auto operator-(Interval<A> a, B b) { return a - Interval<B>{b}; }
+
+template<typename A, typename B, typename = IfNotInterval<A>>
+auto operator-(A a, Interval<B> b) { return Interval<A>{a} - b; }
+
+template<typename A, typename B, typename = IfNotInterval<B>>
+auto operator*(Interval<A> a, B b) { return a * Interval<B>{b}; }
+
+template<typename A, typename B, typename = IfNotInterval<A>>
+auto operator*(A a, Interval<B> b) { return Interval<A>{a} * b; }
+
+template<typename A, typename B, typename = IfNotInterval<B>>
+auto operator/(Interval<A> a, B b) { return a / Interval<B>{b}; }
+
+template<typename A, typename B, typename = IfNotInterval<A>>
+auto operator/(A a, Interval<B> b) { return Interval<A>{a} / b; }
+
+template<typename T>
+constexpr Interval<T> operator-(Interval<T> a) { return {-a.upper(), -a.lower()}; }
+
+template<typename T>
+constexpr Interval<T> operator+(Interval<T> a) { return a; }
+
+/* Functions. Monotonic ones map the bounds, the others also look at the
+ * extremes that fall inside the interval. Arguments outside of the
+ * domain of a function are clamped to it.
+ */
+
+template<typename T>
+constexpr Interval<T> Abs(Interval<T> v)
+{
+    if (!(v.lower() < T{}))
+        return v;
+    if (!(T{} < v.upper()))
+        return -v;
+    return {T{}, __Upper(-v.lower(), v.upper())};
+}
+
+template<typename T>
+auto Sqrt(Interval<T> v) -> Interval<decltype(Sqrt(v.lower()))>
+{
+    auto r = __Outward(Sqrt(__Upper(v.lower(), T{})), Sqrt(__Upper(v.upper(), T{})));
+    return {__Upper(r.lower(), decltype(r.lower()){}), r.upper()};
+}
+
+template<typename T>
+auto Sqr(Interval<T> v) -> Interval<decltype(Sqr(v.lower()))>
+{
+    auto a = Abs(v);
+    auto r = __Outward(Sqr(a.lower()), Sqr(a.upper()));
+    return {__Upper(r.lower(), decltype(r.lower()){}), r.upper()};
+}
+
+template<typename T>
+auto Cube(Interval<T> v) -> Interval<decltype(Cube(v.lower()))>
+{ return __Outward(Cube(v.lower()), Cube(v.upper())); }
+
+/* Sine is at its top at pi/2 + 2k*pi and at its bottom at -pi/2 + 2k*pi.
+ * The interval holds one of those when the first one after its lower
+ * bound isn't past its upper bound.
+ */
+inline bool __HoldsPeriodic(Real lo, Real hi, Real at)
+{
+    constexpr Real twoPi = 2 * __constmath::Pi;
+    Real first = at + twoPi * ceil((lo - at) / twoPi);
+    return first <= hi;
+}
+
+/* The bounds of a function with a period of 2*pi, from its values at
+ * the ends and where its top and bottom are. Cosine isn't worked out as
+ * a shifted sine, since the shift would round the ends.
+ */
+inline Interval<Real> __PeriodicBounds(Real lo, Real hi, Real (*f)(Real), Real topAt, Real bottomAt)
+{
+    constexpr Real pi = __constmath::Pi;
+    if (hi - lo >= 2 * pi)
+        return {-1.0, 1.0};
+    Real a = f(lo), b = f(hi);
+    auto r = __Outward(__Lower(a, b), __Upper(a, b));
+    Real top = __HoldsPeriodic(lo, hi, topAt) ? 1.0 : __Lower(r.upper(), 1.0);
+    Real bottom = __HoldsPeriodic(lo, hi, bottomAt) ? -1.0 : __Upper(r.lower(), -1.0);
+    return {bottom, top};
+}
+
+inline Interval<Real> Sin(Interval<Angle> v)
+{
+    constexpr Real pi = __constmath::Pi;
+    return __PeriodicBounds(v.lower() / Angle::unit(), v.upper() / Angle::unit(), ::sin, pi / 2, -pi / 2);
+}
+
+/* Cosine is at its top at 2k*pi and at its bottom at pi + 2k*pi */
+inline Interval<Real> Cos(Interval<Angle> v)
+{
+    constexpr Real pi = __constmath::Pi;
+    return __PeriodicBounds(v.lower() / Angle::unit(), v.upper() / Angle::unit(), ::cos, 0.0, pi);
+}
+
+/* Tangent goes through infinity at pi/2 + k*pi */
+inline Interval<Real> Tan(Interval<Angle> v)
+{
+    constexpr Real pi = __constmath::Pi;
+    Real lo = v.lower() / Angle::unit(), hi = v.upper() / Angle::unit();
+    Real pole = pi / 2 + pi * ceil((lo - pi / 2) / pi);
+    if (hi - lo >= pi || pole <= hi)
+        return __Everything<Real>();
+    return __Outward(tan(lo), tan(hi));
+}
+
+inline Interval<Real> __ClampUnit(Interval<Real> v)
+{
+    return {__Upper(v.lower(), -1.0), __Lower(v.upper(), 1.0)};
+}
+
+inline Interval<Angle> ACos(Interval<Real> v)
+{
+    auto c = __ClampUnit(v);
+    return __Outward(ACos(c.upper()), ACos(c.lower()));
+}
+
+inline Interval<Angle> ASin(Interval<Real> v)
+{
+    auto c = __ClampUnit(v);
+    return __Outward(ASin(c.lower()), ASin(c.upper()));
+}
+
+inline Interval<Angle> ATan(Interval<Real> v)
+{
+    return __Outward(ATan(v.lower()), ATan(v.upper()));
+}
+
+/* A box that holds the origin or crosses the negative x axis, where the
+ * angle jumps from pi to -pi, can have any angle. Otherwise the angles
+ * of a box are between the ones of its corners.
+ */
+template<typename T>
+auto ATan2(Interval<T> y, Interval<T> x) -> Interval<decltype(ATan2(y.lower(), x.lower()))>
+{
+    using R = decltype(ATan2(y.lower(), x.lower()));
+    constexpr Real pi = __constmath::Pi;
+    if (x.lower() < T{} && y.lower() < T{} && !(y.upper() < T{}))
+        return {-pi * Angle::unit(), pi * Angle::unit()};
+    if (x.contains(T{}) && y.contains(T{}))
+        return {-pi * Angle::unit(), pi * Angle::unit()};
+    R a0 = ATan2(y.lower(), x.lower());
+    R a1 = ATan2(y.lower(), x.upper());
+    R a2 = ATan2(y.upper(), x.lower());
+    R a3 = ATan2(y.upper(), x.upper());
+    return __Outward(__Lower(__Lower(a0, a1), __Lower(a2, a3)),
+                     __Upper(__Upper(a0, a1), __Upper(a2, a3)));
+}
+
+} // namespace frogs
+
+#endif // _FROGS_INTERVAL_H
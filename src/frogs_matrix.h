@@ -78,32 +78,35 @@ public:
         return m_data[col%Cols][row%Rows];
     }
 
-    Str toString() const
+    void appendTo(Str& out) const
     {
-        Str s = "[";
+        out += '[';
         for (std::uint8_t i = 0 ; i < Rows ; i++)
         {
-            s += "[";
+            out += '[';
             for (std::uint8_t j = 0 ; j < Cols-1 ; j++)
-                s += conv2str(m_data[j][i]) + ", ";
-            s += conv2str(m_data[Cols-1][i]) + "]";
+            {
+                append2str(out, m_data[j][i]);
+                out += ", ";
+            }
+            append2str(out, m_data[Cols-1][i]);
+            out += ']';
             if (i < Rows-1)
-                s += ", ";
+                out += ", ";
         }
-        s += "]";
-        return s;
+        out += ']';
     }
 
+    Str toString() const { Str s; appendTo(s); return s; }
+
     friend std::ostream &operator<<(std::ostream &output, const Matrix<T,Rows,Cols>& obj)
     {
-        output << obj.toString();
-        return output;
+        return __Print(output, obj);
     }
 
     friend std::ostream &operator<<(std::ostream &output, const Matrix<T,Rows,Cols>&& obj)
     {
-        output << obj.toString();
-        return output;
+        return __Print(output, obj);
     }
 };
 
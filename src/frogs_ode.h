@@ -0,0 +1,277 @@
+#ifndef _FROGS_ODE_H
+#define _FROGS_ODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+
+#include "frogs_expressions.h"
+#include "frogs_tape.h"
+#include "frogs_batch.h"
+#include "frogs_parallel.h"
+
+namespace frogs
+{
+
+/* Integrators for systems of ordinary differential equations, stepped
+ * for a large batch of independent systems that share the same
+ * dynamics. Each state variable has a rate, an expression of the
+ * states, the time and any other variables:
+ *
+ * auto t = Var{0_sec, "t"};
+ * auto x = Var{0_m, "x"};
+ * auto v = Var{0_mps, "v"};
+ * auto drag = Var{0.1, "drag"};
+ * auto system = Ode(t, Rate(x, v), Rate(v, -9.8_mps2 - drag*v/1_sec));
+ *
+ * std::vector<Distance> xs(100000);
+ * std::vector<Velocity> vs(100000);
+ * std::vector<Real> drags(100000);
+ * system.rk4(pool, 1_msec, 1000, State(x, xs), State(v, vs), Bind(drag, drags));
+ *
+ * The types come from the units, so the rate of a Distance has to be a
+ * Velocity if the time is a Time. The states are kept in arrays, one
+ * for each variable, and they're updated in place. Variables bound with
+ * Bind() give each system its own value of a parameter. The variables
+ * themselves aren't changed, and the ones that aren't bound keep their
+ * current value, which is where the time starts too.
+ */
+
+/* The rate of change of a state variable */
+template<typename T, typename R>
+struct OdeRate
+{
+    Var<T>* var;
+    Tape<R> tape;
+};
+
+template<typename T, typename Exp>
+auto Rate(Var<T>& var, Exp&& rate)
+{
+    auto tape = Compile(rate);
+    return OdeRate<T, ValueOf<decltype(tape)>>{&var, std::move(tape)};
+}
+
+/* The values a state variable has across the batch, which are updated
+ * in place.
+ */
+template<typename T>
+struct OdeState
+{
+    Var<T>* var;
+    T* data;
+    std::size_t size;
+};
+
+template<typename T>
+OdeState<T> State(Var<T>& var, T* data, std::size_t size)
+{
+    return {&var, data, size};
+}
+
+template<typename T, class Container>
+OdeState<T> State(Var<T>& var, Container& values)
+{
+    return {&var, values.data(), values.size()};
+}
+
+/* The working set of a block of lanes. The registers of all the tapes
+ * are back to back, and so are the states.
+ */
+struct OdeLanes
+{
+    std::size_t lanes = 0;
+    std::vector<Real> regs;
+    std::vector<Real> y;
+};
+
+/* The part of a system that doesn't depend on its types. The states,
+ * the time and the rates are all raw values here.
+ */
+class OdeCode
+{
+protected:
+    std::vector<TapeCode> m_tapes;
+    std::vector<const void*> m_states;
+    std::vector<Real> m_scales;
+    std::vector<std::uint32_t> m_slots;
+    std::vector<std::size_t> m_offsets;
+    std::size_t m_registers = 0;
+    const void* m_time = nullptr;
+
+    void link();
+    void rates(OdeLanes& lanes, const Real* y, const Real* t, Real* k) const;
+
+public:
+    static constexpr std::size_t npos = ~std::size_t{0};
+
+    /* The number of attempted steps a lane of rk45 may take */
+    static constexpr std::size_t MaxSteps = 1000000;
+
+    std::size_t states() const { return m_states.size(); }
+    std::size_t findState(const void* var) const;
+
+    /* Sets up a block with the registers of the tapes, which have to
+     * be synced beforehand.
+     */
+    void prepare(OdeLanes& lanes, std::size_t count) const;
+
+    /* Gives a variable that isn't a state its own value in each lane */
+    void bind(OdeLanes& lanes, const void* var, const Real* values) const;
+
+    /* Fixed steps of the classic 4th order Runge-Kutta */
+    void rk4(OdeLanes& lanes, Real t0, Real dt, std::size_t steps) const;
+
+    /* Dormand-Prince 5(4) with an adaptive step for each lane. Returns
+     * the number of lanes that got to the end.
+     */
+    std::size_t rk45(OdeLanes& lanes, Real t0, Real duration, Real tol) const;
+};
+
+template<typename TT>
+class OdeSystem : public OdeCode
+{
+protected:
+    Var<TT>* m_timeVar;
+
+    template<typename T>
+    void load(OdeLanes& lanes, OdeState<T>& state, std::size_t offset) const
+    {
+        auto s = findState(state.var);
+        assert(s != npos);
+        Real* y = lanes.y.data() + s * BatchLanes;
+        for (std::size_t i = 0 ; i < lanes.lanes ; i++)
+            y[i] = RawTraits<T>::raw(state.data[offset + i]);
+    }
+
+    template<typename T>
+    void load(OdeLanes& lanes, BatchInput<T>& input, std::size_t offset) const
+    {
+        Real values[BatchLanes];
+        for (std::size_t i = 0 ; i < lanes.lanes ; i++)
+            values[i] = RawTraits<T>::raw(input.data[offset + i]);
+        bind(lanes, input.var, values);
+    }
+
+    template<typename T>
+    void store(OdeLanes& lanes, OdeState<T>& state, std::size_t offset) const
+    {
+        const Real* y = lanes.y.data() + findState(state.var) * BatchLanes;
+        for (std::size_t i = 0 ; i < lanes.lanes ; i++)
+            state.data[offset + i] = RawTraits<T>::from(y[i]);
+    }
+
+    template<typename T>
+    void store(OdeLanes&, BatchInput<T>&, std::size_t) const {}
+
+    /* Runs a kernel over every block of lanes, on the pool if there's one */
+    template<typename Kernel, typename... Bs>
+    std::size_t run(ThreadPool* pool, Kernel kernel, Bs... bindings)
+    {
+        static_assert(sizeof...(Bs) > 0, "Nothing to integrate");
+        for (auto& tape : m_tapes)
+            tape.sync();
+
+        std::size_t n = std::min({bindings.size...});
+        std::size_t blocks = (n + BatchLanes - 1) / BatchLanes;
+        std::atomic<std::size_t> count{0};
+        auto task = [&](std::size_t block)
+        {
+            std::size_t offset = block * BatchLanes;
+            OdeLanes lanes;
+            prepare(lanes, std::min(BatchLanes, n - offset));
+            (load(lanes, bindings, offset), ...);
+            count += kernel(lanes);
+            (store(lanes, bindings, offset), ...);
+        };
+
+        if (pool)
+            pool->run(blocks, task);
+        else
+            for (std::size_t block = 0 ; block < blocks ; block++)
+                task(block);
+        return count;
+    }
+
+    template<typename T, typename R>
+    void add(OdeRate<T,R>& rate)
+    {
+        using Change = decltype(RawTraits<R>::unit() * RawTraits<TT>::unit());
+        static_assert(std::is_convertible_v<Change, T>, "The rate doesn't match the type of its state");
+        assert(findState(rate.var) == npos);
+        m_states.push_back(rate.var);
+        m_tapes.push_back(std::move(rate.tape));
+        m_scales.push_back(RawTraits<T>::raw(RawTraits<R>::unit() * RawTraits<TT>::unit()));
+    }
+
+    template<typename... Bs>
+    void rk4(ThreadPool* pool, TT dt, std::size_t steps, Bs... bindings)
+    {
+        Real t0 = RawTraits<TT>::raw(m_timeVar->val());
+        Real h = RawTraits<TT>::raw(dt);
+        run(pool, [&](OdeLanes& lanes) { OdeCode::rk4(lanes, t0, h, steps); return lanes.lanes; },
+            bindings...);
+    }
+
+    template<typename... Bs>
+    std::size_t rk45(ThreadPool* pool, TT duration, Real tol, Bs... bindings)
+    {
+        Real t0 = RawTraits<TT>::raw(m_timeVar->val());
+        Real span = RawTraits<TT>::raw(duration);
+        return run(pool, [&](OdeLanes& lanes) { return OdeCode::rk45(lanes, t0, span, tol); },
+                   bindings...);
+    }
+
+public:
+    template<typename... Ts, typename... Rs>
+    OdeSystem(Var<TT>& time, OdeRate<Ts,Rs>... rates) : m_timeVar{&time}
+    {
+        m_time = &time;
+        (add(rates), ...);
+        link();
+    }
+
+    /* Takes the given number of fixed steps */
+    template<typename... Bs>
+    void rk4(ThreadPool& pool, TT dt, std::size_t steps, Bs... bindings)
+    {
+        rk4(&pool, dt, steps, bindings...);
+    }
+
+    template<typename... Bs>
+    void rk4(TT dt, std::size_t steps, Bs... bindings)
+    {
+        rk4(static_cast<ThreadPool*>(nullptr), dt, steps, bindings...);
+    }
+
+    /* Integrates over the given duration, each system with steps of its
+     * own that keep the local error below tol, relative to the size of
+     * the states. Returns the number of systems that got to the end. The
+     * rest stop where they gave up.
+     */
+    template<typename... Bs>
+    std::size_t rk45(ThreadPool& pool, TT duration, Real tol, Bs... bindings)
+    {
+        return rk45(&pool, duration, tol, bindings...);
+    }
+
+    template<typename... Bs>
+    std::size_t rk45(TT duration, Real tol, Bs... bindings)
+    {
+        return rk45(static_cast<ThreadPool*>(nullptr), duration, tol, bindings...);
+    }
+};
+
+template<typename TT, typename... Ts, typename... Rs>
+OdeSystem<TT> Ode(Var<TT>& time, OdeRate<Ts,Rs>... rates)
+{
+    return OdeSystem<TT>{time, std::move(rates)...};
+}
+
+} // namespace frogs
+
+#endif // _FROGS_ODE_H
@@ -0,0 +1,192 @@
+#ifndef _FROGS_PARALLEL_H
+#define _FROGS_PARALLEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+#include <cassert>
+
+#include "frogs_tape.h"
+
+namespace frogs
+{
+
+/* A pool of worker threads that runs a set of independent tasks. Each
+ * worker has its own queue and takes its tasks from the front of it.
+ * A worker whose queue runs dry steals from the back of the others,
+ * so a queue that got the slow tasks is helped by the rest.
+ */
+class ThreadPool
+{
+protected:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<std::size_t> tasks;
+    };
+
+    std::vector<std::thread> m_threads;
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    const std::function<void(std::size_t)>* m_task = nullptr;
+    std::atomic<std::size_t> m_pending{0};
+    std::uint64_t m_generation = 0;
+    bool m_stop = false;
+    std::mutex m_lock;
+    std::mutex m_runLock;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    bool pop(std::size_t self, std::size_t& task);
+    void drain(std::size_t self);
+    void work(std::size_t self);
+
+public:
+    /* The calling thread takes part in every run and counts as one of
+     * the threads.
+     */
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t threads() const { return m_queues.size(); }
+
+    /* Runs task(i) for every i below count and returns when they're all
+     * done. Consecutive tasks start on the same queue, so tasks that are
+     * next to each other are likely run by the same thread.
+     */
+    void run(std::size_t count, const std::function<void(std::size_t)>& task);
+};
+
+/* A handle to the result of one of the expressions of a batch */
+template<typename R>
+struct BatchResult
+{
+    std::uint32_t index;
+};
+
+/* The results of one evaluation of a batch. They're only replaced as a
+ * whole, so a reader holding one sees values that all belong together.
+ * A snapshot only has the results of the expressions that were added
+ * before it was evaluated, so has() tells whether one can be read.
+ */
+class BatchSnapshot
+{
+protected:
+    std::vector<Real> m_values;
+
+    friend class ExpressionBatch;
+
+public:
+    template<typename R>
+    bool has(BatchResult<R> result) const { return result.index < m_values.size(); }
+
+    template<typename R>
+    R get(BatchResult<R> result) const
+    {
+        assert(has(result));
+        return RawTraits<R>::from(m_values[result.index]);
+    }
+
+    std::size_t size() const { return m_values.size(); }
+};
+
+/* The cost of an instruction compared to an addition. It's only used to
+ * balance the work between threads, so rough figures will do.
+ */
+constexpr std::size_t TapeOpCost(TapeOp op)
+{
+    switch (op)
+    {
+    case TapeOp::Div:
+    case TapeOp::Sqrt:
+        return 4;
+    case TapeOp::Cos:
+    case TapeOp::Sin:
+    case TapeOp::Tan:
+    case TapeOp::ACos:
+    case TapeOp::ASin:
+    case TapeOp::ATan:
+    case TapeOp::ATan2:
+        return 20;
+    default:
+        return 1;
+    }
+}
+
+/* Many independent expressions that are evaluated together, like all
+ * the quantities derived in a tick:
+ *
+ * ExpressionBatch batch;
+ * auto speed = batch.add(Sqrt(vx*vx + vy*vy));
+ * auto heading = batch.add(ATan2(vy, vx));
+ * batch.evaluate(pool);
+ * batch.commit();
+ * batch.get(speed);
+ *
+ * The expressions can be of different types. Each is compiled, and the
+ * tapes are split into runs of about the same cost that the pool takes
+ * in parallel. Results go into a back buffer, and commit() makes that
+ * the one readers see. A snapshot taken before a commit stays the same
+ * for as long as it's held. The result of an expression can only be read
+ * once the batch has been evaluated and committed after its add(). The
+ * variables shouldn't be written while a batch is being evaluated.
+ */
+class ExpressionBatch
+{
+protected:
+    std::vector<TapeCode> m_tapes;
+    std::vector<std::size_t> m_costs;
+    std::vector<std::size_t> m_runs;
+    std::size_t m_runsFor = 0;
+    std::shared_ptr<BatchSnapshot> m_front;
+    std::shared_ptr<BatchSnapshot> m_back;
+
+    void plan(std::size_t threads);
+    void evaluateRun(std::size_t run);
+    BatchSnapshot& back();
+
+public:
+    ExpressionBatch() : m_front{std::make_shared<BatchSnapshot>()} {}
+
+    template<typename Exp>
+    auto add(Exp&& expr)
+    {
+        auto tape = __TapeOf(expr);
+        using R = ValueOf<decltype(tape)>;
+        std::size_t cost = tape.slots();
+        for (auto& i : tape.code())
+            cost += TapeOpCost(i.op);
+        m_tapes.push_back(std::move(tape));
+        m_costs.push_back(cost);
+        m_runs.clear();
+        return BatchResult<R>{static_cast<std::uint32_t>(m_tapes.size() - 1)};
+    }
+
+    std::size_t size() const { return m_tapes.size(); }
+
+    /* Evaluates every expression into the back buffer */
+    void evaluate(ThreadPool& pool);
+    void evaluate();
+
+    /* Makes the last evaluation the one that's read */
+    void commit();
+
+    std::shared_ptr<const BatchSnapshot> snapshot() const { return std::atomic_load(&m_front); }
+
+    /* Reads a result of the last commit, which must have it */
+    template<typename R>
+    R get(BatchResult<R> result) const { return snapshot()->get(result); }
+};
+
+} // namespace frogs
+
+#endif // _FROGS_PARALLEL_H
@@ -1,6 +1,7 @@
 #ifndef _FROGS_PHYSICAL_TYPES_H
 #define _FROGS_PHYSICAL_TYPES_H
 
+#include "frogs_fixed.h"
 #include "frogs_types_creator.h"
 #include "frogs_types_fallback.h"
 #include "frogs_constants.h"
@@ -210,15 +211,15 @@ IMPL_CONV_MUL(DistanceT, 1, VelocityT, 1, toMetersPerSecond, TimeT, 1, toSeconds
 IMPL_CLASS(Angle)
 IMPL_UNIT(AngleT, 1, _rad)
 IMPL_UNIT(AngleT, 1, _deg)
-constexpr Real Cos(Unit<1,AngleT> v) { return cos($(v).toRadians()); }
-constexpr Real Sin(Unit<1,AngleT> v) { return sin($(v).toRadians()); }
-constexpr Real Tan(Unit<1,AngleT> v) { return tan($(v).toRadians()); }
-constexpr Unit<1,AngleT> ACos(Real v) { return {{acos(v)}}; }
-constexpr Unit<1,AngleT> ASin(Real v) { return {{asin(v)}}; }
-constexpr Unit<1,AngleT> ATan(Real v) { return {{atan(v)}}; }
-constexpr Unit<1,AngleT> ATan2(Real a, Real b) { return {{atan2(a,b)}}; }
+constexpr Real Cos(Unit<1,AngleT> v) { return __Cos($(v).toRadians()); }
+constexpr Real Sin(Unit<1,AngleT> v) { return __Sin($(v).toRadians()); }
+constexpr Real Tan(Unit<1,AngleT> v) { return __Tan($(v).toRadians()); }
+constexpr Unit<1,AngleT> ACos(Real v) { return {{__ACos(v)}}; }
+constexpr Unit<1,AngleT> ASin(Real v) { return {{__ASin(v)}}; }
+constexpr Unit<1,AngleT> ATan(Real v) { return {{__ATan(v)}}; }
+constexpr Unit<1,AngleT> ATan2(Real a, Real b) { return {{__ATan2(a,b)}}; }
 constexpr Unit<1,AngleT> ATan2(Unit<1,DistanceT> a, Unit<1,DistanceT> b)
-{ return {AngleT<1>{atan2($(a).toMeters(), $(b).toMeters())}}; }
+{ return {AngleT<1>{__ATan2($(a).toMeters(), $(b).toMeters())}}; }
 
 IMPL_CLASS(Time)
 IMPL_UNIT(TimeT, 1, _hours)
@@ -266,13 +267,14 @@ IMPL_CLASS(Momentum)
 IMPL_UNIT(MomentumT, 1, _kgmps)
 IMPL_CONV_MUL(MomentumT, 1, MassT, 1, toGrams, VelocityT, 1, toMetersPerSecond)
 IMPL_CONV_MUL(MomentumT, 1, MassFlowT, 1, toGramsPerSecond, DistanceT, 1, toMeters)
-IMPL_CONV_MUL(MomentumT, 1, ForceT, 1, toNewtons, DistanceT, 1, toMeters)
+/* Momentum is in g*m/s, which is a newton millisecond */
+IMPL_CONV_MUL(MomentumT, 1, ForceT, 1, toNewtons, TimeT, 1, toMilliseconds)
 IMPL_CONV_AB_DIV_C(MomentumT, 1, MassT, 1, toGrams, DistanceT, 1, toMeters, TimeT, 1, toSeconds)
 
 IMPL_CLASS(Force)
 IMPL_UNIT(ForceT, 1, _N)
-IMPL_CONV_MUL(ForceT, 1, MassT, 1, toGrams, AccelerationT, 1, toMetersPerSecond2)
-IMPL_CONV_DIV(ForceT, 1, MomentumT, 1, toGramsMetersPerSecond, TimeT, 1, toSeconds)
+IMPL_CONV_MUL(ForceT, 1, MassT, 1, toKilograms, AccelerationT, 1, toMetersPerSecond2)
+IMPL_CONV_DIV(ForceT, 1, MomentumT, 1, toKilogramsMetersPerSecond, TimeT, 1, toSeconds)
 
 IMPL_CLASS(Energy)
 IMPL_UNIT(EnergyT, 1, _J)
@@ -319,6 +321,37 @@ using Angle = Unit<1,AngleT>;
 using Dpi = Unit<1,DpiT>;
 using Pixels = Unit<1,PixelsT>;
 
+/* The same types kept in a float, for large arrays where memory is what
+ * limits the speed. They're widened to the types above implicitly, and
+ * narrowed from them only explicitly.
+ */
+using DistanceF = Unit<1,DistanceT,float>;
+using AreaF = Unit<2,DistanceT,float>;
+using VolumeF = Unit<3,DistanceT,float>;
+using TimeF = Unit<1,TimeT,float>;
+using FrequencyF = Unit<-1,TimeT,float>;
+using PowerF = Unit<1,PowerT,float>;
+using EnergyF = Unit<1,EnergyT,float>;
+using MassF = Unit<1,MassT,float>;
+using MassFlowF = Unit<1,MassFlowT,float>;
+using ForceF = Unit<1,ForceT,float>;
+using VelocityF = Unit<1,VelocityT,float>;
+using AccelerationF = Unit<1,AccelerationT,float>;
+using AngleF = Unit<1,AngleT,float>;
+using DpiF = Unit<1,DpiT,float>;
+using PixelsF = Unit<1,PixelsT,float>;
+
+/* Time and distance kept as integers, in nanoseconds and micrometres.
+ * Adding and comparing them is exact, so a timestamp doesn't drift no
+ * matter how many steps are added to it. Converting to and from the
+ * types above is explicit.
+ */
+using TimeNs = Unit<1,TimeT,Fixed<std::int64_t,std::nano>>;
+using DistanceUm = Unit<1,DistanceT,Fixed<std::int64_t,std::micro>>;
+
 } // namespace frogs
 
+/* Products of classes that don't have a conversion of their own */
+#include "frogs_quantity.h"
+
 #endif // _FROGS_PHYSICAL_TYPES_H
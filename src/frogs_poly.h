@@ -0,0 +1,554 @@
+#ifndef _FROGS_POLY_H
+#define _FROGS_POLY_H
+
+#include <array>
+#include <utility>
+#include <type_traits>
+
+#include "frogs_expressions.h"
+#include "frogs_diff.h"
+#include "frogs_tape.h"
+
+namespace frogs
+{
+
+/* Polynomials in one variable, evaluated by Horner's rule.
+ *
+ * A formula like 0.2_mps2*t*t + 10_mps*t + 20_m is a tree of five
+ * multiplications and two additions. As a polynomial it's
+ * (0.2 * t + 10) * t + 20, which is two of each and reads t once.
+ * Horner() finds the parts of an expression that are polynomials and
+ * rewrites them this way, and Polynomial() makes one from coefficients.
+ */
+
+/* The shape of a polynomial: the type of its value and its degree. It's
+ * a single template argument so that PolyExp has two of them like the
+ * other nodes, and works with their operators.
+ */
+template<typename R, int N>
+struct PolyOf {};
+
+template<int K, typename V, typename X>
+constexpr auto __DivPow(V v, X x)
+{
+    if constexpr (K == 0)
+        return v;
+    else
+        return __DivPow<K - 1>(v / x, x);
+}
+
+template<int K, typename V, typename X>
+constexpr auto __MulPow(V v, X x)
+{
+    if constexpr (K == 0)
+        return v;
+    else
+        return __MulPow<K - 1>(v * x, x);
+}
+
+template<class Arg, class Shape>
+class PolyExp;
+
+/* The coefficients are kept as raw values, the same way a tape keeps
+ * them. Coefficient k is the raw value of the result when the raw value
+ * of the argument is one, so the sum is the raw value of the result.
+ */
+template<class Arg, typename R, int N>
+class PolyExp<Arg, PolyOf<R,N>> : public Expr<PolyExp<Arg, PolyOf<R,N>>>
+{
+protected:
+    Arg m_x;
+    std::array<Real, N + 1> m_coefs;
+
+public:
+    using X = ValueOf<Arg>;
+
+    constexpr PolyExp(Arg x, std::array<Real, N + 1> coefs) : m_x{x}, m_coefs{coefs} {}
+
+    constexpr R val() const
+    {
+        Real x = RawTraits<X>::raw($(m_x));
+        Real sum = m_coefs[N];
+        for (int k = N - 1 ; k >= 0 ; k--)
+            sum = sum * x + m_coefs[k];
+        return RawTraits<R>::from(sum);
+    }
+
+    constexpr Arg arg() const { return m_x; }
+    static constexpr int degree() { return N; }
+    constexpr const std::array<Real, N + 1>& coefs() const { return m_coefs; }
+
+    /* The coefficient of x^K with its unit, like 0.2_mps2 for t^2 */
+    template<int K>
+    constexpr auto coefficient() const
+    {
+        static_assert(K >= 0 && K <= N, "No such coefficient");
+        return __DivPow<K>(RawTraits<R>::from(m_coefs[K]), RawTraits<X>::unit());
+    }
+
+    void appendTo(Str& out) const
+    {
+        /* Terms with a zero coefficient are left out */
+        out += '(';
+        bool first = true;
+        for (int k = 0 ; k <= N ; k++)
+        {
+            if (m_coefs[k] == 0.0)
+                continue;
+            if (!first)
+                out += " + ";
+            first = false;
+            append2str(out, m_coefs[k]);
+            if (k == 0)
+                continue;
+            out += " * ";
+            append2str(out, m_x);
+            if (k > 1)
+            {
+                out += '^';
+                append2str(out, k);
+            }
+        }
+        if (first)
+            out += '0';
+        out += ')';
+    }
+
+    friend std::ostream &operator<<(std::ostream &output, const PolyExp& obj)
+    {
+        return __Print(output, obj);
+    }
+};
+
+template<class Arg, typename R, int N, typename VT>
+auto Replace(PolyExp<Arg, PolyOf<R,N>> exp, Var<VT>& var)
+{
+    auto x = Replace(exp.arg(), var);
+    return PolyExp<decltype(x), PolyOf<R,N>>{x, exp.coefs()};
+}
+
+template<class Arg, typename R, int N, typename VT, typename V>
+constexpr auto Substitute(PolyExp<Arg, PolyOf<R,N>> exp, Var<VT>& var, V value)
+{
+    auto x = Substitute(exp.arg(), var, value);
+    return PolyExp<decltype(x), PolyOf<R,N>>{x, exp.coefs()};
+}
+
+template<class Arg, typename R, int N>
+constexpr Integer NodeCount(PolyExp<Arg, PolyOf<R,N>> exp)
+{
+    return 1 + NodeCount(exp.arg());
+}
+
+/* Makes a polynomial from its coefficients, lowest power first. They
+ * have the units of the result divided by powers of the variable:
+ *
+ * auto distance = Polynomial(t, 20_m, 10_mps, 0.2_mps2);
+ */
+template<typename T, typename C0, typename... Cs, std::size_t... K>
+constexpr auto __Polynomial(Var<T>& x, std::index_sequence<K...>, C0 c0, Cs... cs)
+{
+    static_assert(RawTraits<T>::supported && RawTraits<C0>::supported,
+                  "Polynomial types must be Reals or physical units");
+    constexpr int N = sizeof...(Cs);
+    auto u = RawTraits<T>::unit();
+    return PolyExp<Var<T>*, PolyOf<C0,N>>{
+        &x, {RawTraits<C0>::raw(c0), RawTraits<C0>::raw(__MulPow<K + 1>(cs, u))...}};
+}
+
+template<typename T, typename C0, typename... Cs>
+constexpr auto Polynomial(Var<T>& x, C0 c0, Cs... cs)
+{
+    return __Polynomial(x, std::index_sequence_for<Cs...>{}, c0, cs...);
+}
+
+/* Finding polynomials. __PolyOf() gives the raw coefficients of a
+ * subtree and the variable they're in, or __NotPoly when it isn't a
+ * polynomial of one variable. Constants have no variable, which is
+ * marked by void. Two variables of the same type are only told apart at
+ * run time, so a form where they differ is marked as mixed, and its
+ * coefficients mean nothing.
+ */
+struct __NotPoly {};
+
+template<typename X, int N>
+struct __PolyForm
+{
+    Var<X>* var;
+    std::array<Real, N + 1> coefs;
+    bool mixed = false;
+};
+
+template<typename X, typename Y>
+using __PolyVar = std::conditional_t<std::is_void_v<X>, Y,
+                  std::conditional_t<std::is_void_v<Y> || std::is_same_v<X, Y>, X, __NotPoly>>;
+
+template<typename X, int N, typename Y, int M>
+constexpr Var<__PolyVar<X,Y>>* __PolyJoin(__PolyForm<X,N> a, __PolyForm<Y,M> b)
+{
+    if constexpr (std::is_void_v<X>)
+        return b.var;
+    else if constexpr (std::is_void_v<Y>)
+        return a.var;
+    else
+        return a.var;
+}
+
+template<typename X, int N, typename Y, int M>
+constexpr bool __PolyMixed(__PolyForm<X,N> a, __PolyForm<Y,M> b)
+{
+    if constexpr (std::is_void_v<X> || std::is_void_v<Y>)
+        return a.mixed || b.mixed;
+    else
+        return a.mixed || b.mixed || a.var != b.var;
+}
+
+template<class Exp>
+constexpr __NotPoly __PolyOf(Exp expr) { return {}; }
+
+template<typename T>
+constexpr auto __PolyOf(Var<T>* expr)
+{
+    if constexpr (RawTraits<T>::supported)
+        return __PolyForm<T,1>{expr, {0.0, 1.0}};
+    else
+        return __NotPoly{};
+}
+
+template<typename T>
+constexpr auto __PolyOf(Const<T,DummyClass> expr)
+{
+    if constexpr (RawTraits<T>::supported)
+        return __PolyForm<void,0>{nullptr, {RawTraits<T>::raw(expr.val())}};
+    else
+        return __NotPoly{};
+}
+
+template<typename T>
+constexpr auto __PolyOf(ZeroExp<T,DummyClass> expr)
+{
+    return __PolyForm<void,0>{nullptr, {0.0}};
+}
+
+template<typename X, int N>
+constexpr auto __PolyScale(__PolyForm<X,N> a, Real k)
+{
+    for (auto& c : a.coefs)
+        c *= k;
+    return a;
+}
+
+template<typename A>
+constexpr auto __PolyScale(A a, Real k) { return a; }
+
+template<typename X, int N, typename Y, int M>
+constexpr auto __PolyAdd(__PolyForm<X,N> a, __PolyForm<Y,M> b, Real sign)
+{
+    using Z = __PolyVar<X,Y>;
+    if constexpr (std::is_same_v<Z, __NotPoly>)
+        return __NotPoly{};
+    else
+    {
+        __PolyForm<Z, (N > M ? N : M)> r{__PolyJoin(a, b), {}, __PolyMixed(a, b)};
+        for (int i = 0 ; i <= N ; i++)
+            r.coefs[i] += a.coefs[i];
+        for (int i = 0 ; i <= M ; i++)
+            r.coefs[i] += sign * b.coefs[i];
+        return r;
+    }
+}
+
+template<typename A, typename B>
+constexpr __NotPoly __PolyAdd(A a, B b, Real sign) { return {}; }
+
+template<typename X, int N, typename Y, int M>
+constexpr auto __PolyMul(__PolyForm<X,N> a, __PolyForm<Y,M> b, Real k)
+{
+    using Z = __PolyVar<X,Y>;
+    if constexpr (std::is_same_v<Z, __NotPoly>)
+        return __NotPoly{};
+    else
+    {
+        __PolyForm<Z, N + M> r{__PolyJoin(a, b), {}, __PolyMixed(a, b)};
+        for (int i = 0 ; i <= N ; i++)
+            for (int j = 0 ; j <= M ; j++)
+                r.coefs[i + j] += k * a.coefs[i] * b.coefs[j];
+        return r;
+    }
+}
+
+template<typename A, typename B>
+constexpr __NotPoly __PolyMul(A a, B b, Real k) { return {}; }
+
+template<class Exp0, class Exp1>
+constexpr auto __PolyOf(Add<Exp0,Exp1> expr)
+{
+    return __PolyAdd(__PolyOf(expr.first()), __PolyOf(expr.second()), 1.0);
+}
+
+template<class Exp0, class Exp1>
+constexpr auto __PolyOf(Sub<Exp0,Exp1> expr)
+{
+    return __PolyAdd(__PolyOf(expr.first()), __PolyOf(expr.second()), -1.0);
+}
+
+/* Products of units may have a scale factor, the same one the tape
+ * applies after a multiplication.
+ */
+template<class Exp0, class Exp1>
+constexpr auto __PolyOf(Mul<Exp0,Exp1> expr)
+{
+    using R = ValueOf<Mul<Exp0,Exp1>>;
+    using A = ValueOf<Exp0>;
+    using B = ValueOf<Exp1>;
+    if constexpr (RawTraits<R>::supported && RawTraits<A>::supported && RawTraits<B>::supported)
+    {
+        constexpr Real k = RawTraits<R>::raw(MulFunc(RawTraits<A>::unit(), RawTraits<B>::unit()));
+        return __PolyMul(__PolyOf(expr.first()), __PolyOf(expr.second()), k);
+    }
+    else
+        return __NotPoly{};
+}
+
+/* Only division by a constant keeps a polynomial */
+template<class Exp0, class Exp1>
+constexpr auto __PolyOf(Div<Exp0,Exp1> expr)
+{
+    using R = ValueOf<Div<Exp0,Exp1>>;
+    using A = ValueOf<Exp0>;
+    using B = ValueOf<Exp1>;
+    auto b = __PolyOf(expr.second());
+    if constexpr (std::is_same_v<decltype(b), __PolyForm<void,0>> && RawTraits<R>::supported
+                  && RawTraits<A>::supported && RawTraits<B>::supported)
+    {
+        constexpr Real k = RawTraits<R>::raw(DivFunc(RawTraits<A>::unit(), RawTraits<B>::unit()));
+        return __PolyScale(__PolyOf(expr.first()), k / b.coefs[0]);
+    }
+    else
+        return __NotPoly{};
+}
+
+template<class Exp>
+constexpr auto __PolyOf(Neg<Exp,DummyClass> expr)
+{
+    return __PolyScale(__PolyOf(expr.arg()), -1.0);
+}
+
+template<class Exp>
+constexpr auto __PolyOf(Pos<Exp,DummyClass> expr)
+{
+    return __PolyOf(expr.arg());
+}
+
+template<class Exp>
+constexpr auto __PolyOf(SqrExp<Exp,DummyClass> expr)
+{
+    using R = ValueOf<SqrExp<Exp,DummyClass>>;
+    using A = ValueOf<Exp>;
+    if constexpr (RawTraits<R>::supported && RawTraits<A>::supported)
+    {
+        constexpr Real k = RawTraits<R>::raw(Sqr(RawTraits<A>::unit()));
+        auto a = __PolyOf(expr.arg());
+        return __PolyMul(a, a, k);
+    }
+    else
+        return __NotPoly{};
+}
+
+template<class Exp>
+constexpr auto __PolyOf(CubeExp<Exp,DummyClass> expr)
+{
+    using R = ValueOf<CubeExp<Exp,DummyClass>>;
+    using A = ValueOf<Exp>;
+    if constexpr (RawTraits<R>::supported && RawTraits<A>::supported)
+    {
+        constexpr Real k = RawTraits<R>::raw(Cube(RawTraits<A>::unit()));
+        auto a = __PolyOf(expr.arg());
+        return __PolyMul(__PolyMul(a, a, 1.0), a, k);
+    }
+    else
+        return __NotPoly{};
+}
+
+/* What Horner() makes of a subtree that has the shape of a polynomial.
+ * Whether its variables are all the same one is only known at run time,
+ * so the subtree is kept next to the PolyExp, and it's used instead when
+ * they aren't.
+ */
+template<class Poly, class Tree>
+class HornerExp : public Expr<HornerExp<Poly,Tree>>
+{
+protected:
+    Poly m_poly;
+    Tree m_tree;
+    bool m_isPoly;
+
+public:
+    constexpr HornerExp(Poly poly, Tree tree, bool isPoly) : m_poly{poly}, m_tree{tree}, m_isPoly{isPoly} {}
+
+    constexpr ValueOf<Poly> val() const
+    {
+        if (m_isPoly)
+            return $(m_poly);
+        return ValueOf<Poly>{$(m_tree)};
+    }
+
+    constexpr Poly poly() const { return m_poly; }
+    constexpr Tree tree() const { return m_tree; }
+    constexpr bool isPoly() const { return m_isPoly; }
+
+    void appendTo(Str& out) const
+    {
+        if (m_isPoly)
+            append2str(out, m_poly);
+        else
+            append2str(out, m_tree);
+    }
+
+    friend std::ostream &operator<<(std::ostream &output, const HornerExp& obj)
+    {
+        return __Print(output, obj);
+    }
+};
+
+template<class Poly, class Tree, typename VT>
+auto Replace(HornerExp<Poly,Tree> exp, Var<VT>& var)
+{
+    return HornerExp{Replace(exp.poly(), var), Replace(exp.tree(), var), exp.isPoly()};
+}
+
+template<class Poly, class Tree, typename VT, typename V>
+constexpr auto Substitute(HornerExp<Poly,Tree> exp, Var<VT>& var, V value)
+{
+    return HornerExp{Substitute(exp.poly(), var, value), Substitute(exp.tree(), var, value), exp.isPoly()};
+}
+
+template<class Poly, class Tree>
+constexpr Integer NodeCount(HornerExp<Poly,Tree> exp)
+{
+    return exp.isPoly() ? NodeCount(exp.poly()) : NodeCount(exp.tree());
+}
+
+/* Rewriting. A subtree that's a polynomial of degree one or more becomes
+ * a PolyExp, unless it's only the variable. Anything else keeps its node
+ * and has its operands rewritten.
+ */
+template<typename Exp>
+constexpr auto Horner(Exp expr);
+
+template<typename T>
+constexpr Var<T>& Horner(Var<T>& expr) { return expr; }
+
+template<class Exp>
+constexpr auto __HornerArgs(Exp expr) { return expr; }
+
+#define DECL_HORNER_1(ClassName) \
+template<typename Exp> \
+constexpr auto __HornerArgs(ClassName<Exp,DummyClass> expr) \
+{ return ClassName{Horner(expr.arg())}; }
+
+#define DECL_HORNER_2(ClassName) \
+template<class Exp0, class Exp1> \
+constexpr auto __HornerArgs(ClassName<Exp0,Exp1> expr) \
+{ return ClassName{Horner(expr.first()), Horner(expr.second())}; }
+
+DECL_HORNER_2(Add)
+DECL_HORNER_2(Sub)
+DECL_HORNER_2(Mul)
+DECL_HORNER_2(Div)
+DECL_HORNER_2(ATan2Exp)
+DECL_HORNER_1(Neg)
+DECL_HORNER_1(Pos)
+DECL_HORNER_1(AbsExp)
+DECL_HORNER_1(SqrtExp)
+DECL_HORNER_1(SqrExp)
+DECL_HORNER_1(CubeExp)
+DECL_HORNER_1(CosExp)
+DECL_HORNER_1(SinExp)
+DECL_HORNER_1(TanExp)
+DECL_HORNER_1(ACosExp)
+DECL_HORNER_1(ASinExp)
+DECL_HORNER_1(ATanExp)
+
+template<typename R, typename X, int N>
+constexpr bool __IsHorner(__PolyForm<X,N>)
+{
+    return !std::is_void_v<X> && N >= 1 && RawTraits<R>::supported;
+}
+
+template<typename R, typename A>
+constexpr bool __IsHorner(A) { return false; }
+
+template<typename R, typename X, int N>
+constexpr auto __MakePoly(__PolyForm<X,N> form)
+{
+    return PolyExp<Var<X>*, PolyOf<R,N>>{form.var, form.coefs};
+}
+
+template<typename Exp>
+constexpr auto Horner(Exp expr)
+{
+    using R = ValueOf<Exp>;
+    auto form = __PolyOf(expr);
+    if constexpr (!std::is_pointer_v<Exp> && __IsHorner<R>(decltype(form){}))
+        return HornerExp{__MakePoly<R>(form), expr, !form.mixed};
+    else
+        return __HornerArgs(expr);
+}
+
+/* Differentiation works on the coefficients, so the derivative of a
+ * polynomial is a polynomial of one degree less. The derivative of the
+ * argument is one for the variable and zero when it's been substituted.
+ *
+ * if f(x) = c0 + c1 * x + c2 * x^2 + ...
+ * then f`(x) = c1 + 2 * c2 * x + ...
+ */
+template<class Arg, typename R, int N, typename DT>
+constexpr auto __Diff(PolyExp<Arg, PolyOf<R,N>> expr, Var<DT>& dt)
+{
+    using X = ValueOf<Arg>;
+    Real k = RawTraits<X>::raw($(__Diff(expr.arg(), dt)));
+    auto& c = expr.coefs();
+    if constexpr (N == 0)
+        return ZeroExp<R>{};
+    else if constexpr (N == 1)
+        return Const{RawTraits<R>::from(k * c[1])};
+    else
+    {
+        std::array<Real, N> d{};
+        for (int i = 1 ; i <= N ; i++)
+            d[i - 1] = k * i * c[i];
+        return PolyExp<Arg, PolyOf<R, N - 1>>{expr.arg(), d};
+    }
+}
+
+template<class Poly, class Tree, typename DT>
+constexpr auto __Diff(HornerExp<Poly,Tree> expr, Var<DT>& dt)
+{
+    return HornerExp{__Diff(expr.poly(), dt), __Diff(expr.tree(), dt), expr.isPoly()};
+}
+
+/* On a tape a polynomial is a chain of multiply-adds. The multiplication
+ * by the leading constant becomes a scale.
+ */
+template<class Arg, typename R, int N>
+std::uint32_t __Emit(TapeCode& tape, PolyExp<Arg, PolyOf<R,N>> expr)
+{
+    static_assert(RawTraits<R>::supported, "Polynomial type can't be compiled");
+    auto x = __Emit(tape, expr.arg());
+    auto& c = expr.coefs();
+    auto sum = tape.constant(c[N]);
+    for (int k = N - 1 ; k >= 0 ; k--)
+        sum = tape.emit(TapeOp::Add, tape.emit(TapeOp::Mul, sum, x), tape.constant(c[k]));
+    return sum;
+}
+
+template<class Poly, class Tree>
+std::uint32_t __Emit(TapeCode& tape, HornerExp<Poly,Tree> expr)
+{
+    return expr.isPoly() ? __Emit(tape, expr.poly()) : __Emit(tape, expr.tree());
+}
+
+} // namespace frogs
+
+#endif // _FROGS_POLY_H
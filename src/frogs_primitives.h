@@ -2,6 +2,10 @@
 #define _FROGS_PRIMITIVES_H
 
 #include <string>
+#include <charconv>
+#include <ostream>
+#include <cstring>
+#include <limits>
 #include <math.h>
 
 namespace frogs
@@ -11,23 +15,277 @@ using Integer = unsigned long long;
 using Real = double;
 using Str = std::string;
 
+/* Formatting appends to a buffer that the caller owns. Printing many
+ * values can reuse one string instead of building a temporary for each
+ * part. Reals are written in the shortest form that reads back exactly.
+ */
+template<class T> void append2str(Str& out, const T& v) { v.appendTo(out); }
+template<class T> void append2str(Str& out, T* v) { v->appendTo(out); }
+void append2str(Str& out, Real v);
+void append2str(Str& out, float v);
+void append2str(Str& out, long double v);
+
+template<class T>
+inline void __AppendInteger(Str& out, T v)
+{
+    char buffer[24];
+    auto end = std::to_chars(buffer, buffer + sizeof(buffer), v).ptr;
+    out.append(buffer, end);
+}
+
+inline void append2str(Str& out, Integer v) { __AppendInteger(out, v); }
+inline void append2str(Str& out, int v) { __AppendInteger(out, v); }
+
 template<class T> Str conv2str(T&& v) { return v.toString(); }
 template<class T> Str conv2str(T* v) { return v->toString(); }
-Str conv2str(Real v);
+inline Str conv2str(Real v) { Str s; append2str(s, v); return s; }
+inline Str conv2str(Integer v) { Str s; append2str(s, v); return s; }
+inline Str conv2str(int v) { Str s; append2str(s, v); return s; }
+
+/* Streams a value through a buffer that's kept per thread, so printing
+ * doesn't allocate once the buffer has grown.
+ */
+template<class T>
+std::ostream& __Print(std::ostream& output, const T& v)
+{
+    thread_local Str buffer;
+    buffer.clear();
+    append2str(buffer, v);
+    return output << buffer;
+}
+
+/* Math that also works in constant expressions. While the compiler is
+ * evaluating a constant these use the series below, and at run time
+ * they call the C library, so run time results are the same as before.
+ */
+#if defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+# define FROGS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+# define FROGS_CONSTANT_EVALUATED() false
+#endif
+
+namespace __constmath
+{
+
+constexpr Real Pi = 3.14159265358979323846;
+constexpr Real HalfPi = 1.5707963267948966;
+constexpr Real NaN = std::numeric_limits<Real>::quiet_NaN();
+constexpr Real Inf = std::numeric_limits<Real>::infinity();
+
+/* Newton's method after scaling into [1/4, 4] by powers of four */
+constexpr Real sqrt(Real x)
+{
+    if (x != x || x < 0)
+        return NaN;
+    if (x == 0 || x == Inf)
+        return x;
+    Real scale = 1.0;
+    for ( ; x > 4.0 ; x *= 0.25)
+        scale *= 2.0;
+    for ( ; x < 0.25 ; x *= 4.0)
+        scale *= 0.5;
+    Real r = 1.0;
+    for (int i = 0 ; i < 7 ; i++)
+        r = 0.5 * (r + x / r);
+    return r * scale;
+}
+
+/* Taylor series that are accurate for |x| <= pi/4. They're nested and
+ * summed from the smallest term up, which keeps the rounding down.
+ */
+constexpr Real sinKernel(Real x)
+{
+    Real x2 = x * x, sum = 1.0;
+    for (int n = 11 ; n > 0 ; n--)
+        sum = 1.0 - x2 / ((2 * n) * (2 * n + 1)) * sum;
+    return x * sum;
+}
+
+constexpr Real cosKernel(Real x)
+{
+    Real x2 = x * x, sum = 1.0;
+    for (int n = 11 ; n > 1 ; n--)
+        sum = 1.0 - x2 / ((2 * n - 1) * (2 * n)) * sum;
+    return 1.0 - x2 / 2 * sum;
+}
+
+/* Reduces x to r in [-pi/4, pi/4], where x = r + q * pi/2. Pi/2 is
+ * split into parts of 24 bits and a tail, so that q times each part is
+ * exact for any |x| up to ReduceMax, and the differences are summed with
+ * their rounding errors. Past that the reduction isn't accurate anymore,
+ * and sin() and cos() give NaN.
+ */
+constexpr Real HalfPiParts[5] = {
+    1.570796251296997, 7.549789415861596e-08, 5.390302529957765e-15,
+    3.282003415807913e-22, 1.2706558760139879e-29
+};
+
+constexpr Real ReduceMax = 268435456.0;
+
+struct Reduced
+{
+    Real r;
+    int quadrant;
+};
+
+constexpr Reduced reduce(Real x)
+{
+    Real q = x / HalfPi;
+    long long n = static_cast<long long>(q < 0 ? q - 0.5 : q + 0.5);
+    if (n == 0)
+        return {x, 0};
+    Real hi = x, lo = 0.0;
+    for (Real part : HalfPiParts)
+    {
+        Real p = n * part;
+        Real diff = hi - p;
+        Real back = diff - hi;
+        lo += (hi - (diff - back)) - (p + back);
+        hi = diff;
+    }
+    return {hi + lo, static_cast<int>(((n % 4) + 4) % 4)};
+}
+
+constexpr Real sin(Real x)
+{
+    if (x != x || x > ReduceMax || x < -ReduceMax)
+        return NaN;
+    auto [r, q] = reduce(x);
+    switch (q)
+    {
+    case 0: return sinKernel(r);
+    case 1: return cosKernel(r);
+    case 2: return -sinKernel(r);
+    default: return -cosKernel(r);
+    }
+}
+
+constexpr Real cos(Real x)
+{
+    if (x != x || x > ReduceMax || x < -ReduceMax)
+        return NaN;
+    auto [r, q] = reduce(x);
+    switch (q)
+    {
+    case 0: return cosKernel(r);
+    case 1: return -sinKernel(r);
+    case 2: return -cosKernel(r);
+    default: return sinKernel(r);
+    }
+}
 
-inline Str conv2str(Integer v) { return std::to_string(v); }
-inline Str conv2str(int v) { return std::to_string(v); }
+constexpr Real tan(Real x) { return sin(x) / cos(x); }
 
-inline auto Abs(Real v) { return v < 0 ? -v : v; }
-inline auto Abs(Integer v) { return v < 0 ? -v : v; }
-inline auto Abs(int v) { return v < 0 ? -v : v; }
+/* Two half angle steps bring the argument under tan(pi/16), where the
+ * series converges quickly.
+ */
+constexpr Real atan(Real x)
+{
+    if (x != x || x == 0)
+        return x;
+    bool negative = x < 0;
+    if (negative)
+        x = -x;
+    bool inverted = x > 1.0;
+    if (inverted)
+        x = 1.0 / x;
+    x = x / (1.0 + sqrt(1.0 + x * x));
+    x = x / (1.0 + sqrt(1.0 + x * x));
+    Real x2 = x * x, power = x, sum = x;
+    for (int n = 1 ; n < 14 ; n++)
+    {
+        power *= -x2;
+        sum += power / (2 * n + 1);
+    }
+    sum *= 4.0;
+    if (inverted)
+        sum = Pi / 2 - sum;
+    return negative ? -sum : sum;
+}
 
-inline auto Sqrt(Real v) { return sqrt(v); }
-inline auto Sqrt(Integer v) { return sqrt(v); }
-inline auto Sqrt(int v) { return sqrt(v); }
+/* Tells -0 from +0, which comparisons can't */
+constexpr bool signbit(Real x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_signbit(x);
+#else
+    return x < 0;
+#endif
+}
+
+/* The signs of zeros and infinities pick the quadrant, as in the C
+ * library.
+ */
+constexpr Real atan2(Real y, Real x)
+{
+    if (x != x || y != y)
+        return NaN;
+    bool negative = signbit(y);
+    if (y == 0)
+        return signbit(x) ? (negative ? -Pi : Pi) : y;
+    if (x == 0)
+        return negative ? -Pi / 2 : Pi / 2;
+    if ((x == Inf || x == -Inf) && (y == Inf || y == -Inf))
+    {
+        Real r = (x > 0) ? Pi / 4 : 3 * Pi / 4;
+        return negative ? -r : r;
+    }
+    if (x > 0)
+        return atan(y / x);
+    return negative ? atan(y / x) - Pi : atan(y / x) + Pi;
+}
+
+constexpr Real asin(Real x) { return atan2(x, sqrt(1.0 - x * x)); }
+constexpr Real acos(Real x) { return atan2(sqrt(1.0 - x * x), x); }
+
+} // namespace __constmath
+
+#define DECL_CONSTEXPR_MATH_1(Name, Func) \
+constexpr Real Name(Real v) \
+{ return FROGS_CONSTANT_EVALUATED() ? __constmath::Func(v) : ::Func(v); }
+
+DECL_CONSTEXPR_MATH_1(__Sqrt, sqrt)
+DECL_CONSTEXPR_MATH_1(__Cos, cos)
+DECL_CONSTEXPR_MATH_1(__Sin, sin)
+DECL_CONSTEXPR_MATH_1(__Tan, tan)
+DECL_CONSTEXPR_MATH_1(__ACos, acos)
+DECL_CONSTEXPR_MATH_1(__ASin, asin)
+DECL_CONSTEXPR_MATH_1(__ATan, atan)
+
+constexpr Real __ATan2(Real y, Real x)
+{ return FROGS_CONSTANT_EVALUATED() ? __constmath::atan2(y, x) : ::atan2(y, x); }
+
+constexpr auto Abs(Real v) { return v < 0 ? -v : v; }
+constexpr auto Abs(float v) { return v < 0 ? -v : v; }
+constexpr auto Abs(long double v) { return v < 0 ? -v : v; }
+constexpr auto Abs(Integer v) { return v; }
+constexpr auto Abs(int v) { return v < 0 ? -v : v; }
+
+constexpr auto Sqrt(Real v) { return __Sqrt(v); }
+constexpr auto Sqrt(float v) { return static_cast<float>(__Sqrt(v)); }
+constexpr auto Sqrt(long double v)
+{ return FROGS_CONSTANT_EVALUATED() ? __constmath::sqrt(static_cast<Real>(v)) : ::sqrtl(v); }
+constexpr auto Sqrt(Integer v) { return __Sqrt(static_cast<Real>(v)); }
+constexpr auto Sqrt(int v) { return __Sqrt(static_cast<Real>(v)); }
+
+constexpr auto Sqr(Real v) { return v * v; }
+constexpr auto Sqr(float v) { return v * v; }
+constexpr auto Sqr(long double v) { return v * v; }
+constexpr auto Sqr(Integer v) { return v * v; }
+constexpr auto Sqr(int v) { return v * v; }
+
+constexpr auto Cube(Real v) { return v * v * v; }
+constexpr auto Cube(float v) { return v * v * v; }
+constexpr auto Cube(long double v) { return v * v * v; }
+constexpr auto Cube(Integer v) { return v * v * v; }
+constexpr auto Cube(int v) { return v * v * v; }
 
 constexpr Real One(Real) { return 1.0; }
 constexpr Real Zero(Real) { return 0.0; }
+constexpr float One(float) { return 1.0f; }
+constexpr float Zero(float) { return 0.0f; }
+constexpr long double One(long double) { return 1.0L; }
+constexpr long double Zero(long double) { return 0.0L; }
 constexpr unsigned char One(unsigned char) { return 1; }
 constexpr unsigned char Zero(unsigned char) { return 0; }
 constexpr char One(char) { return 1; }
@@ -45,23 +303,26 @@ constexpr unsigned long Zero(unsigned long) { return 0; }
 constexpr long One(long) { return 1; }
 constexpr long Zero(long) { return 0; }
 
-inline Str operator+(Str a, Str b)
+/* The left side is taken by value so that a chain of additions keeps
+ * appending to the same temporary.
+ */
+inline Str operator+(Str a, const Str& b)
 {
-    Str result = a;
-    result += b;
-    return result;
+    a += b;
+    return a;
 }
 
 inline Str operator+(Str a, const char* b)
 {
-    Str result = a;
-    result += b;
-    return result;
+    a += b;
+    return a;
 }
 
-inline Str operator+(const char* a, Str b)
+inline Str operator+(const char* a, const Str& b)
 {
-    Str result = a;
+    Str result;
+    result.reserve(strlen(a) + b.size());
+    result += a;
     result += b;
     return result;
 }
@@ -0,0 +1,408 @@
+#ifndef _FROGS_QUANTITY_H
+#define _FROGS_QUANTITY_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <math.h>
+
+#include "frogs_primitives.h"
+#include "frogs_physical_types.h"
+
+namespace frogs
+{
+
+/* A dimension is the exponent of each base quantity. The typed units
+ * check dimensions at compile time through their classes and powers,
+ * and this is the same check done at run time.
+ */
+enum class BaseDim : std::uint8_t { Length, Mass, Time, Angle, Pixels };
+
+constexpr std::size_t BaseDims = 5;
+
+class Dimension
+{
+private:
+    std::array<std::int8_t, BaseDims> m_exp{};
+
+public:
+    constexpr Dimension() {}
+    constexpr Dimension(int length, int mass, int time, int angle = 0, int pixels = 0)
+        : m_exp{static_cast<std::int8_t>(length), static_cast<std::int8_t>(mass),
+                static_cast<std::int8_t>(time), static_cast<std::int8_t>(angle),
+                static_cast<std::int8_t>(pixels)} {}
+
+    constexpr int operator[](BaseDim d) const { return m_exp[static_cast<std::size_t>(d)]; }
+
+    constexpr bool dimensionless() const
+    {
+        for (auto e : m_exp)
+            if (e != 0)
+                return false;
+        return true;
+    }
+
+    constexpr Dimension pow(int n) const
+    {
+        Dimension r;
+        for (std::size_t i = 0 ; i < BaseDims ; i++)
+            r.m_exp[i] = static_cast<std::int8_t>(m_exp[i] * n);
+        return r;
+    }
+
+    /* Whether the n-th root has whole exponents */
+    constexpr bool hasRoot(int n) const
+    {
+        for (auto e : m_exp)
+            if (e % n != 0)
+                return false;
+        return true;
+    }
+
+    constexpr Dimension root(int n) const
+    {
+        Dimension r;
+        for (std::size_t i = 0 ; i < BaseDims ; i++)
+            r.m_exp[i] = static_cast<std::int8_t>(m_exp[i] / n);
+        return r;
+    }
+
+    constexpr Dimension operator*(Dimension b) const
+    {
+        Dimension r;
+        for (std::size_t i = 0 ; i < BaseDims ; i++)
+            r.m_exp[i] = static_cast<std::int8_t>(m_exp[i] + b.m_exp[i]);
+        return r;
+    }
+
+    constexpr Dimension operator/(Dimension b) const { return *this * b.pow(-1); }
+
+    constexpr bool operator==(Dimension b) const
+    {
+        for (std::size_t i = 0 ; i < BaseDims ; i++)
+            if (m_exp[i] != b.m_exp[i])
+                return false;
+        return true;
+    }
+
+    constexpr bool operator!=(Dimension b) const { return !(*this == b); }
+
+    void appendTo(Str& out) const;
+    Str toString() const { Str s; appendTo(s); return s; }
+
+    friend std::ostream &operator<<(std::ostream &output, const Dimension& obj)
+    {
+        return __Print(output, obj);
+    }
+};
+
+/* The dimension of each class of units, and the factor that takes its
+ * raw value to SI. The raw values are in the base unit of the class,
+ * which isn't always the SI one (mass is in grams).
+ */
+template<template<int...> class C>
+struct ClassDim
+{
+    static constexpr bool supported = false;
+};
+
+#define DECL_CLASS_DIM(ClassName, Length, Mass, Time, Angle, Pixels, ToSI) \
+template<> \
+struct ClassDim<ClassName##T> \
+{ \
+    static constexpr bool supported = true; \
+    static constexpr Dimension dim{Length, Mass, Time, Angle, Pixels}; \
+    static constexpr Real toSI = ToSI; \
+};
+
+DECL_CLASS_DIM(Distance,     1, 0,  0, 0, 0, 1.0)
+DECL_CLASS_DIM(Angle,        0, 0,  0, 1, 0, 1.0)
+DECL_CLASS_DIM(Time,         0, 0,  1, 0, 0, 1.0)
+DECL_CLASS_DIM(Velocity,     1, 0, -1, 0, 0, 1.0)
+DECL_CLASS_DIM(Acceleration, 1, 0, -2, 0, 0, 1.0)
+DECL_CLASS_DIM(Mass,         0, 1,  0, 0, 0, 1.0e-3)
+DECL_CLASS_DIM(MassFlow,     0, 1, -1, 0, 0, 1.0e-3)
+DECL_CLASS_DIM(Momentum,     1, 1, -1, 0, 0, 1.0e-3)
+DECL_CLASS_DIM(Force,        1, 1, -2, 0, 0, 1.0)
+DECL_CLASS_DIM(Energy,       2, 1, -2, 0, 0, 1.0)
+DECL_CLASS_DIM(Power,        2, 1, -3, 0, 0, 1.0)
+DECL_CLASS_DIM(Pixels,       0, 0,  0, 0, 1, 1.0)
+DECL_CLASS_DIM(Dpi,         -1, 0,  0, 0, 1, 1.0/0.0254)
+
+constexpr Real __IntPow(Real v, int n)
+{
+    Real r = 1.0;
+    for (int i = 0 ; i < (n < 0 ? -n : n) ; i++)
+        r *= v;
+    return n < 0 ? 1.0 / r : r;
+}
+
+/* A quantity whose dimension is known at compile time but that has no
+ * class of its own, like Distance*Time. It holds a single value in the
+ * base units the classes keep their raw values in (metres, grams,
+ * seconds, radians and pixels), so it takes the same memory as any
+ * other unit, and a product or quotient is one multiply or divide:
+ *
+ * auto exposure = 3_m * 2_sec;        // Quantity<1,0,1>, 6 m s
+ * Distance d = exposure / 2_sec;      // back to a class, 3 m
+ *
+ * Multiplying or dividing units of different classes that don't have a
+ * conversion of their own ends up here. When the dimension of the
+ * result matches a class, the result is of that class instead, so
+ * Force*Distance is an Energy and (Mass*Distance)/Time a Momentum.
+ */
+template<int L, int M, int T, int A = 0, int Px = 0>
+class Quantity;
+
+/* The factor that takes the raw value of a unit to the base units of a
+ * Quantity. It's 1 unless the class is in other units, like Force in
+ * newtons (kilograms) or Dpi in inches.
+ */
+template<int P, template<int...> class C>
+constexpr Real __UnitToBase()
+{
+    return __IntPow(ClassDim<C>::toSI / __IntPow(ClassDim<MassT>::toSI, ClassDim<C>::dim[BaseDim::Mass]), P);
+}
+
+template<int P, template<int...> class C>
+constexpr Real __Base(Unit<P,C> v) { return (v / Unit<P,C>::unit()) * __UnitToBase<P,C>(); }
+
+/* The quantity of a unit type, through a dimension that's a constant */
+template<class D>
+using __QuantityWith = Quantity<D::dim[BaseDim::Length], D::dim[BaseDim::Mass], D::dim[BaseDim::Time],
+                                D::dim[BaseDim::Angle], D::dim[BaseDim::Pixels]>;
+
+template<typename U>
+struct __UnitDim;
+
+template<int P, template<int...> class C>
+struct __UnitDim<Unit<P,C>>
+{
+    static constexpr Dimension dim = ClassDim<C>::dim.pow(P);
+};
+
+template<typename U>
+using QuantityOf = __QuantityWith<__UnitDim<U>>;
+
+/* The classes a quantity can turn back into, in the order they're tried */
+template<template<int...> class... Cs>
+struct __UnitClasses {};
+
+using __NamedClasses = __UnitClasses<DistanceT, TimeT, VelocityT, AccelerationT, MassT, MassFlowT,
+                                     MomentumT, ForceT, EnergyT, PowerT, AngleT, PixelsT, DpiT>;
+
+template<int P, class Q, class Classes>
+struct __FindUnit
+{
+    using type = void;
+};
+
+template<int P, class Q, template<int...> class C, template<int...> class... Cs>
+struct __FindUnit<P, Q, __UnitClasses<C, Cs...>>
+{
+    static constexpr bool match = ClassDim<C>::dim.pow(P) == Q::dim;
+    using type = std::conditional_t<match, Unit<P,C>,
+                                    typename __FindUnit<P, Q, __UnitClasses<Cs...>>::type>;
+};
+
+template<class Q, int... Ps>
+struct __NamedUnit
+{
+    using type = void;
+};
+
+template<class Q, int P, int... Ps>
+struct __NamedUnit<Q, P, Ps...>
+{
+    using found = typename __FindUnit<P, Q, __NamedClasses>::type;
+    using type = std::conditional_t<std::is_void_v<found>, typename __NamedUnit<Q, Ps...>::type, found>;
+};
+
+/* The type a value of some dimension takes. It's the class of units
+ * with that dimension if there's one, a Real if it has no dimension,
+ * and a Quantity otherwise.
+ */
+template<int L, int M, int T, int A, int Px>
+constexpr auto __Named(Real raw)
+{
+    using Q = Quantity<L,M,T,A,Px>;
+    using U = typename __NamedUnit<Q, 1, -1, 2, 3, -2, -3>::type;
+    if constexpr (L == 0 && M == 0 && T == 0 && A == 0 && Px == 0)
+        return raw;
+    else if constexpr (std::is_void_v<U>)
+        return Q::fromRaw(raw);
+    else
+        return static_cast<U>(Q::fromRaw(raw));
+}
+
+template<int L, int M, int T, int A, int Px>
+class Quantity
+{
+private:
+    Real m_raw;
+
+    template<int P, template<int...> class C>
+    static constexpr bool matches = ClassDim<C>::supported && ClassDim<C>::dim.pow(P) == Dimension{L, M, T, A, Px};
+
+public:
+    using Self = Quantity<L,M,T,A,Px>;
+    static constexpr Dimension dim{L, M, T, A, Px};
+
+    constexpr Quantity() : m_raw{0.0} {}
+
+    template<int P, template<int...> class C, typename = std::enable_if_t<matches<P,C>>>
+    constexpr Quantity(Unit<P,C> v) : m_raw{__Base(v)} {}
+
+    static constexpr Self fromRaw(Real raw) { Self q; q.m_raw = raw; return q; }
+    static constexpr Self zero() { return {}; }
+    static constexpr Self unit() { return fromRaw(1.0); }
+
+    /* The value in the base units, and in SI */
+    constexpr Real raw() const { return m_raw; }
+    constexpr Real si() const { return m_raw * __IntPow(ClassDim<MassT>::toSI, M); }
+
+    template<int P, template<int...> class C, typename = std::enable_if_t<matches<P,C>>>
+    constexpr operator Unit<P,C>() const { return (m_raw / __UnitToBase<P,C>()) * Unit<P,C>::unit(); }
+
+    constexpr Self& operator+=(Self a) { m_raw += a.m_raw; return *this; }
+    constexpr Self& operator-=(Self a) { m_raw -= a.m_raw; return *this; }
+    constexpr Self& operator*=(Real a) { m_raw *= a; return *this; }
+    constexpr Self& operator/=(Real a) { m_raw /= a; return *this; }
+
+    void appendTo(Str& out) const
+    {
+        append2str(out, si());
+        out += ' ';
+        dim.appendTo(out);
+    }
+
+    Str toString() const { Str s; appendTo(s); return s; }
+
+    friend std::ostream &operator<<(std::ostream &output, const Quantity& obj)
+    {
+        return __Print(output, obj);
+    }
+};
+
+#define QUANTITY_TEMPLATE template<int L, int M, int T, int A, int Px>
+#define QUANTITY_TYPE Quantity<L,M,T,A,Px>
+
+QUANTITY_TEMPLATE constexpr QUANTITY_TYPE operator+(QUANTITY_TYPE a) { return a; }
+QUANTITY_TEMPLATE constexpr QUANTITY_TYPE operator-(QUANTITY_TYPE a) { return QUANTITY_TYPE::fromRaw(-a.raw()); }
+QUANTITY_TEMPLATE constexpr QUANTITY_TYPE operator+(QUANTITY_TYPE a, QUANTITY_TYPE b) { return QUANTITY_TYPE::fromRaw(a.raw() + b.raw()); }
+QUANTITY_TEMPLATE constexpr QUANTITY_TYPE operator-(QUANTITY_TYPE a, QUANTITY_TYPE b) { return QUANTITY_TYPE::fromRaw(a.raw() - b.raw()); }
+QUANTITY_TEMPLATE constexpr QUANTITY_TYPE operator*(QUANTITY_TYPE a, Real b) { return QUANTITY_TYPE::fromRaw(a.raw() * b); }
+QUANTITY_TEMPLATE constexpr QUANTITY_TYPE operator*(Real a, QUANTITY_TYPE b) { return QUANTITY_TYPE::fromRaw(a * b.raw()); }
+QUANTITY_TEMPLATE constexpr QUANTITY_TYPE operator/(QUANTITY_TYPE a, Real b) { return QUANTITY_TYPE::fromRaw(a.raw() / b); }
+QUANTITY_TEMPLATE constexpr auto operator/(Real a, QUANTITY_TYPE b) { return __Named<-L,-M,-T,-A,-Px>(a / b.raw()); }
+
+QUANTITY_TEMPLATE constexpr bool operator==(QUANTITY_TYPE a, QUANTITY_TYPE b) { return a.raw() == b.raw(); }
+QUANTITY_TEMPLATE constexpr bool operator!=(QUANTITY_TYPE a, QUANTITY_TYPE b) { return a.raw() != b.raw(); }
+QUANTITY_TEMPLATE constexpr bool operator<(QUANTITY_TYPE a, QUANTITY_TYPE b) { return a.raw() < b.raw(); }
+QUANTITY_TEMPLATE constexpr bool operator<=(QUANTITY_TYPE a, QUANTITY_TYPE b) { return a.raw() <= b.raw(); }
+QUANTITY_TEMPLATE constexpr bool operator>(QUANTITY_TYPE a, QUANTITY_TYPE b) { return a.raw() > b.raw(); }
+QUANTITY_TEMPLATE constexpr bool operator>=(QUANTITY_TYPE a, QUANTITY_TYPE b) { return a.raw() >= b.raw(); }
+
+QUANTITY_TEMPLATE constexpr QUANTITY_TYPE Abs(QUANTITY_TYPE v) { return QUANTITY_TYPE::fromRaw(Abs(v.raw())); }
+QUANTITY_TEMPLATE constexpr auto Sqr(QUANTITY_TYPE v) { return __Named<2*L,2*M,2*T,2*A,2*Px>(v.raw() * v.raw()); }
+QUANTITY_TEMPLATE constexpr auto Cube(QUANTITY_TYPE v) { return __Named<3*L,3*M,3*T,3*A,3*Px>(v.raw() * v.raw() * v.raw()); }
+QUANTITY_TEMPLATE constexpr QUANTITY_TYPE One(QUANTITY_TYPE) { return QUANTITY_TYPE::unit(); }
+QUANTITY_TEMPLATE constexpr QUANTITY_TYPE Zero(QUANTITY_TYPE) { return QUANTITY_TYPE::zero(); }
+
+QUANTITY_TEMPLATE constexpr auto Sqrt(QUANTITY_TYPE v)
+{
+    static_assert(L % 2 == 0 && M % 2 == 0 && T % 2 == 0 && A % 2 == 0 && Px % 2 == 0,
+                  "Square root of a quantity with an odd exponent");
+    return __Named<L/2,M/2,T/2,A/2,Px/2>(Sqrt(v.raw()));
+}
+
+/* Products and quotients of quantities, and of quantities with units */
+
+template<int L0, int M0, int T0, int A0, int P0, int L1, int M1, int T1, int A1, int P1>
+constexpr auto operator*(Quantity<L0,M0,T0,A0,P0> a, Quantity<L1,M1,T1,A1,P1> b)
+{ return __Named<L0+L1,M0+M1,T0+T1,A0+A1,P0+P1>(a.raw() * b.raw()); }
+
+template<int L0, int M0, int T0, int A0, int P0, int L1, int M1, int T1, int A1, int P1>
+constexpr auto operator/(Quantity<L0,M0,T0,A0,P0> a, Quantity<L1,M1,T1,A1,P1> b)
+{ return __Named<L0-L1,M0-M1,T0-T1,A0-A1,P0-P1>(a.raw() / b.raw()); }
+
+template<int L, int M, int T, int A, int Px, int P, template<int...> class C>
+constexpr auto operator*(QUANTITY_TYPE a, Unit<P,C> b) { return a * QuantityOf<Unit<P,C>>{b}; }
+
+template<int L, int M, int T, int A, int Px, int P, template<int...> class C>
+constexpr auto operator*(Unit<P,C> a, QUANTITY_TYPE b) { return QuantityOf<Unit<P,C>>{a} * b; }
+
+template<int L, int M, int T, int A, int Px, int P, template<int...> class C>
+constexpr auto operator/(QUANTITY_TYPE a, Unit<P,C> b) { return a / QuantityOf<Unit<P,C>>{b}; }
+
+template<int L, int M, int T, int A, int Px, int P, template<int...> class C>
+constexpr auto operator/(Unit<P,C> a, QUANTITY_TYPE b) { return QuantityOf<Unit<P,C>>{a} / b; }
+
+#undef QUANTITY_TEMPLATE
+#undef QUANTITY_TYPE
+
+/* How a result is made from a value in the base units. The product of
+ * two units works on their raw values, and all the factors to and from
+ * the base units are folded into one constant, which goes away when
+ * it's 1, as it is for most classes.
+ */
+template<typename R>
+struct __FromBase
+{
+    static constexpr Real toBase = 1.0;
+    static constexpr R from(Real raw) { return raw; }
+};
+
+template<int L, int M, int T, int A, int Px>
+struct __FromBase<Quantity<L,M,T,A,Px>>
+{
+    static constexpr Real toBase = 1.0;
+    static constexpr Quantity<L,M,T,A,Px> from(Real raw) { return Quantity<L,M,T,A,Px>::fromRaw(raw); }
+};
+
+template<int P, template<int...> class C>
+struct __FromBase<Unit<P,C>>
+{
+    static constexpr Real toBase = __UnitToBase<P,C>();
+    static constexpr Unit<P,C> from(Real raw) { return raw * Unit<P,C>::unit(); }
+};
+
+/* Units of different classes that don't have a conversion between them.
+ * Classes with a known dimension go through Quantity, and the others
+ * are glued together with UnitsMul and UnitsDiv. They're only for Reals,
+ * units with other scalars have to be widened first.
+ */
+template<int PA, template<int...> class A, typename SA, int PB, template<int...> class B, typename SB,
+         typename = std::enable_if_t<std::is_same_v<SA,Real> && std::is_same_v<SB,Real>>>
+constexpr auto operator*(Unit<PA,A,SA> a, Unit<PB,B,SB> b)
+{
+    if constexpr (ClassDim<A>::supported && ClassDim<B>::supported)
+    {
+        using R = decltype(QuantityOf<Unit<PA,A>>{} * QuantityOf<Unit<PB,B>>{});
+        constexpr Real k = __UnitToBase<PA,A>() * __UnitToBase<PB,B>() / __FromBase<R>::toBase;
+        Real v = a.raw() * b.raw();
+        return __FromBase<R>::from(k == 1.0 ? v : v * k);
+    }
+    else
+        return UnitsMul{a,b};
+}
+
+template<int PA, template<int...> class A, typename SA, int PB, template<int...> class B, typename SB,
+         typename = std::enable_if_t<std::is_same_v<SA,Real> && std::is_same_v<SB,Real>>>
+constexpr auto operator/(Unit<PA,A,SA> a, Unit<PB,B,SB> b)
+{
+    if constexpr (ClassDim<A>::supported && ClassDim<B>::supported)
+    {
+        using R = decltype(QuantityOf<Unit<PA,A>>{} / QuantityOf<Unit<PB,B>>{});
+        constexpr Real k = __UnitToBase<PA,A>() / __UnitToBase<PB,B>() / __FromBase<R>::toBase;
+        Real v = a.raw() / b.raw();
+        return __FromBase<R>::from(k == 1.0 ? v : v * k);
+    }
+    else
+        return UnitsDiv{a,b};
+}
+
+} // namespace frogs
+
+#endif // _FROGS_QUANTITY_H
@@ -0,0 +1,249 @@
+#ifndef _FROGS_SIMD_H
+#define _FROGS_SIMD_H
+
+#include <cstddef>
+#include <math.h>
+
+#if defined(__AVX__) || defined(__SSE2__)
+# include <immintrin.h>
+#endif
+
+#include "frogs_primitives.h"
+
+namespace frogs
+{
+
+/* Lane-wise kernels over contiguous arrays of Reals. They use AVX when
+ * the compiler targets it, SSE2 otherwise, and plain loops as a last
+ * resort. Unaligned loads are used so any buffer works.
+ */
+
+#if defined(__AVX__)
+# define FROGS_SIMD_WIDTH 4
+# define FROGS_SIMD_T __m256d
+# define FROGS_SIMD_LOAD _mm256_loadu_pd
+# define FROGS_SIMD_STORE _mm256_storeu_pd
+# define FROGS_SIMD_SET1 _mm256_set1_pd
+# define FROGS_SIMD_ADD _mm256_add_pd
+# define FROGS_SIMD_SUB _mm256_sub_pd
+# define FROGS_SIMD_MUL _mm256_mul_pd
+# define FROGS_SIMD_DIV _mm256_div_pd
+# define FROGS_SIMD_SQRT _mm256_sqrt_pd
+# define FROGS_SIMD_ANDNOT _mm256_andnot_pd
+# define FROGS_SIMD_XOR _mm256_xor_pd
+# define FROGS_SIMD_MIN _mm256_min_pd
+# define FROGS_SIMD_MAX _mm256_max_pd
+#elif defined(__SSE2__)
+# define FROGS_SIMD_WIDTH 2
+# define FROGS_SIMD_T __m128d
+# define FROGS_SIMD_LOAD _mm_loadu_pd
+# define FROGS_SIMD_STORE _mm_storeu_pd
+# define FROGS_SIMD_SET1 _mm_set1_pd
+# define FROGS_SIMD_ADD _mm_add_pd
+# define FROGS_SIMD_SUB _mm_sub_pd
+# define FROGS_SIMD_MUL _mm_mul_pd
+# define FROGS_SIMD_DIV _mm_div_pd
+# define FROGS_SIMD_SQRT _mm_sqrt_pd
+# define FROGS_SIMD_ANDNOT _mm_andnot_pd
+# define FROGS_SIMD_XOR _mm_xor_pd
+# define FROGS_SIMD_MIN _mm_min_pd
+# define FROGS_SIMD_MAX _mm_max_pd
+#endif
+
+/* Each kernel is declared from a vector body and a scalar body. The
+ * scalar one handles the tail and the builds without SIMD.
+ */
+
+#ifdef FROGS_SIMD_WIDTH
+# define DECL_SIMD_KERNEL_2(Name, VecExpr, ScalarExpr) \
+inline void Name(Real* dst, const Real* pa, const Real* pb, std::size_t n) \
+{ \
+    std::size_t i = 0; \
+    for ( ; i + FROGS_SIMD_WIDTH <= n ; i += FROGS_SIMD_WIDTH) \
+    { \
+        FROGS_SIMD_T a = FROGS_SIMD_LOAD(pa + i); \
+        FROGS_SIMD_T b = FROGS_SIMD_LOAD(pb + i); \
+        FROGS_SIMD_STORE(dst + i, VecExpr); \
+    } \
+    for ( ; i < n ; i++) \
+    { \
+        Real a = pa[i]; \
+        Real b = pb[i]; \
+        dst[i] = ScalarExpr; \
+    } \
+}
+# define DECL_SIMD_KERNEL_1(Name, VecExpr, ScalarExpr) \
+inline void Name(Real* dst, const Real* pa, Real k, std::size_t n) \
+{ \
+    std::size_t i = 0; \
+    FROGS_SIMD_T vk = FROGS_SIMD_SET1(k); \
+    (void)vk; \
+    for ( ; i + FROGS_SIMD_WIDTH <= n ; i += FROGS_SIMD_WIDTH) \
+    { \
+        FROGS_SIMD_T a = FROGS_SIMD_LOAD(pa + i); \
+        FROGS_SIMD_STORE(dst + i, VecExpr); \
+    } \
+    for ( ; i < n ; i++) \
+    { \
+        Real a = pa[i]; \
+        dst[i] = ScalarExpr; \
+    } \
+}
+#else
+# define DECL_SIMD_KERNEL_2(Name, VecExpr, ScalarExpr) \
+inline void Name(Real* dst, const Real* pa, const Real* pb, std::size_t n) \
+{ \
+    for (std::size_t i = 0 ; i < n ; i++) \
+    { \
+        Real a = pa[i]; \
+        Real b = pb[i]; \
+        dst[i] = ScalarExpr; \
+    } \
+}
+# define DECL_SIMD_KERNEL_1(Name, VecExpr, ScalarExpr) \
+inline void Name(Real* dst, const Real* pa, Real k, std::size_t n) \
+{ \
+    (void)k; \
+    for (std::size_t i = 0 ; i < n ; i++) \
+    { \
+        Real a = pa[i]; \
+        dst[i] = ScalarExpr; \
+    } \
+}
+#endif
+
+/* Functions that don't have a vector instruction still go lane by lane
+ * through the same interface.
+ */
+#define DECL_LANES_KERNEL_1(Name, ScalarExpr) \
+inline void Name(Real* dst, const Real* pa, Real k, std::size_t n) \
+{ \
+    (void)k; \
+    for (std::size_t i = 0 ; i < n ; i++) \
+    { \
+        Real a = pa[i]; \
+        dst[i] = ScalarExpr; \
+    } \
+}
+
+#define DECL_LANES_KERNEL_2(Name, ScalarExpr) \
+inline void Name(Real* dst, const Real* pa, const Real* pb, std::size_t n) \
+{ \
+    for (std::size_t i = 0 ; i < n ; i++) \
+    { \
+        Real a = pa[i]; \
+        Real b = pb[i]; \
+        dst[i] = ScalarExpr; \
+    } \
+}
+
+DECL_SIMD_KERNEL_2(SimdAdd, FROGS_SIMD_ADD(a, b), a + b)
+DECL_SIMD_KERNEL_2(SimdSub, FROGS_SIMD_SUB(a, b), a - b)
+DECL_SIMD_KERNEL_2(SimdMul, FROGS_SIMD_MUL(a, b), a * b)
+DECL_SIMD_KERNEL_2(SimdDiv, FROGS_SIMD_DIV(a, b), a / b)
+DECL_SIMD_KERNEL_1(SimdScale, FROGS_SIMD_MUL(vk, a), k * a)
+DECL_SIMD_KERNEL_1(SimdShift, FROGS_SIMD_ADD(a, vk), a + k)
+DECL_SIMD_KERNEL_1(SimdUnscale, FROGS_SIMD_DIV(a, vk), a / k)
+DECL_SIMD_KERNEL_1(SimdNeg, FROGS_SIMD_XOR(a, FROGS_SIMD_SET1(-0.0)), -a)
+DECL_SIMD_KERNEL_1(SimdAbs, FROGS_SIMD_ANDNOT(FROGS_SIMD_SET1(-0.0), a), fabs(a))
+DECL_SIMD_KERNEL_1(SimdSqrt, FROGS_SIMD_SQRT(a), sqrt(a))
+DECL_SIMD_KERNEL_1(SimdSqr, FROGS_SIMD_MUL(a, a), a * a)
+DECL_SIMD_KERNEL_1(SimdCube, FROGS_SIMD_MUL(a, FROGS_SIMD_MUL(a, a)), a * a * a)
+DECL_LANES_KERNEL_1(SimdCos, cos(a))
+DECL_LANES_KERNEL_1(SimdSin, sin(a))
+DECL_LANES_KERNEL_1(SimdTan, tan(a))
+DECL_LANES_KERNEL_1(SimdACos, acos(a))
+DECL_LANES_KERNEL_1(SimdASin, asin(a))
+DECL_LANES_KERNEL_1(SimdATan, atan(a))
+DECL_LANES_KERNEL_2(SimdATan2, atan2(a, b))
+
+/* Fills an array with the same value */
+inline void SimdFill(Real* dst, Real v, std::size_t n)
+{
+    for (std::size_t i = 0 ; i < n ; i++)
+        dst[i] = v;
+}
+
+/* dst = a + k*b, the update that integrators are made of */
+inline void SimdAxpy(Real* dst, const Real* pa, const Real* pb, Real k, std::size_t n)
+{
+    std::size_t i = 0;
+#ifdef FROGS_SIMD_WIDTH
+    FROGS_SIMD_T vk = FROGS_SIMD_SET1(k);
+    for ( ; i + FROGS_SIMD_WIDTH <= n ; i += FROGS_SIMD_WIDTH)
+    {
+        FROGS_SIMD_T a = FROGS_SIMD_LOAD(pa + i);
+        FROGS_SIMD_T b = FROGS_SIMD_LOAD(pb + i);
+        FROGS_SIMD_STORE(dst + i, FROGS_SIMD_ADD(a, FROGS_SIMD_MUL(vk, b)));
+    }
+#endif
+    for ( ; i < n ; i++)
+        dst[i] = pa[i] + k * pb[i];
+}
+
+/* Reductions keep a vector of partial results and fold them at the end,
+ * so the order of the additions isn't the same as a plain loop's.
+ */
+#ifdef FROGS_SIMD_WIDTH
+# define DECL_SIMD_REDUCE(Name, Init, VecExpr, ScalarExpr) \
+inline Real Name(const Real* pa, std::size_t n) \
+{ \
+    std::size_t i = 0; \
+    FROGS_SIMD_T acc = FROGS_SIMD_SET1(Init); \
+    for ( ; i + FROGS_SIMD_WIDTH <= n ; i += FROGS_SIMD_WIDTH) \
+    { \
+        FROGS_SIMD_T a = FROGS_SIMD_LOAD(pa + i); \
+        acc = VecExpr; \
+    } \
+    Real lanes[FROGS_SIMD_WIDTH]; \
+    FROGS_SIMD_STORE(lanes, acc); \
+    Real r = Init; \
+    for (Real a : lanes) \
+        r = ScalarExpr; \
+    for ( ; i < n ; i++) \
+    { \
+        Real a = pa[i]; \
+        r = ScalarExpr; \
+    } \
+    return r; \
+}
+#else
+# define DECL_SIMD_REDUCE(Name, Init, VecExpr, ScalarExpr) \
+inline Real Name(const Real* pa, std::size_t n) \
+{ \
+    Real r = Init; \
+    for (std::size_t i = 0 ; i < n ; i++) \
+    { \
+        Real a = pa[i]; \
+        r = ScalarExpr; \
+    } \
+    return r; \
+}
+#endif
+
+DECL_SIMD_REDUCE(SimdSum, 0.0, FROGS_SIMD_ADD(acc, a), r + a)
+DECL_SIMD_REDUCE(SimdMin, __constmath::Inf, FROGS_SIMD_MIN(acc, a), (a < r) ? a : r)
+DECL_SIMD_REDUCE(SimdMax, -__constmath::Inf, FROGS_SIMD_MAX(acc, a), (a > r) ? a : r)
+
+/* The sum of the products of two arrays */
+inline Real SimdDot(const Real* pa, const Real* pb, std::size_t n)
+{
+    std::size_t i = 0;
+    Real r = 0.0;
+#ifdef FROGS_SIMD_WIDTH
+    FROGS_SIMD_T acc = FROGS_SIMD_SET1(0.0);
+    for ( ; i + FROGS_SIMD_WIDTH <= n ; i += FROGS_SIMD_WIDTH)
+        acc = FROGS_SIMD_ADD(acc, FROGS_SIMD_MUL(FROGS_SIMD_LOAD(pa + i), FROGS_SIMD_LOAD(pb + i)));
+    Real lanes[FROGS_SIMD_WIDTH];
+    FROGS_SIMD_STORE(lanes, acc);
+    for (Real a : lanes)
+        r += a;
+#endif
+    for ( ; i < n ; i++)
+        r += pa[i] * pb[i];
+    return r;
+}
+
+} // namespace frogs
+
+#endif // _FROGS_SIMD_H
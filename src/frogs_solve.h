@@ -0,0 +1,240 @@
+#ifndef _FROGS_SOLVE_H
+#define _FROGS_SOLVE_H
+
+#include <cstddef>
+#include <vector>
+#include <limits>
+#include <optional>
+#include <algorithm>
+#include <cassert>
+#include <math.h>
+
+#include "frogs_expressions.h"
+#include "frogs_diff.h"
+#include "frogs_tape.h"
+#include "frogs_batch.h"
+#include "frogs_interval.h"
+
+namespace frogs
+{
+
+/* An equation between two expressions. It's kept as the residual, the
+ * difference of both sides, which is zero at a solution:
+ *
+ * auto t = Var{0_sec, "t"};
+ * auto distance = 0.2_mps2*t*t + 10_mps*t + 20_m;
+ * auto when = Solve(distance == 100_m, t, Interval{0_sec, 60_sec});
+ */
+template<class Exp>
+class Equation
+{
+protected:
+    Exp m_residual;
+
+public:
+    constexpr Equation(Exp residual) : m_residual{residual} {}
+
+    constexpr Exp residual() const { return m_residual; }
+
+    void appendTo(Str& out) const
+    {
+        append2str(out, m_residual);
+        out += " == 0";
+    }
+
+    Str toString() const { Str s; appendTo(s); return s; }
+
+    friend std::ostream &operator<<(std::ostream &output, const Equation& obj)
+    {
+        return __Print(output, obj);
+    }
+};
+
+template<class Exp> Equation(Exp) -> Equation<Exp>;
+
+template<typename A, typename B, template<class...> class Exp0,
+         typename T, typename = IfExpr<Exp0<A,B>>>
+constexpr auto operator==(Exp0<A,B> a, T b) { return Equation{a - b}; }
+
+template<typename A, typename B, typename C, typename D,
+         template<class...> class Exp0, template<class...> class Exp1,
+         typename = IfExpr<Exp0<A,B>,Exp1<C,D>>>
+constexpr auto operator==(Exp0<A,B> a, Exp1<C,D> b) { return Equation{a - b}; }
+
+template<typename A, typename B, template<class...> class Exp0,
+         typename T, typename = IfExpr<Exp0<A,B>>>
+constexpr auto operator==(Exp0<A,B> a, Var<T>& b) { return Equation{a - b}; }
+
+template<typename A, typename B, template<class...> class Exp0,
+         typename T, typename = IfExpr<Exp0<A,B>>>
+constexpr auto operator==(Var<T>& a, Exp0<A,B> b) { return Equation{a - b}; }
+
+/* The solver stops once a step, or the bracket, is smaller than this
+ * relative to the size of the root.
+ */
+constexpr Real SolveTolerance = 1e-12;
+constexpr std::size_t SolveIterations = 100;
+
+/* Solves an equation for var within a bracket, for n different sets of
+ * values of the other variables at once. The two ends of the bracket
+ * must give the residual different signs.
+ *
+ * Each step is a Newton step with the derivative from Diff. When it
+ * would leave the bracket, or the derivative is zero, it bisects
+ * instead, so it converges wherever there's a sign change. The lanes
+ * of a block run through the batched tape kernels together, and a
+ * lane that converged is masked off while the rest go on.
+ *
+ * Lanes that didn't converge, or had no sign change, get NaN. Returns
+ * the number of lanes that were solved. Var keeps its value.
+ */
+template<class Exp, typename T, typename... Ts>
+std::size_t SolveBatch(const Equation<Exp>& eq, Var<T>& var, Interval<T> bracket,
+                       T* out, std::size_t n, BatchInput<Ts>... inputs)
+{
+    assert(((inputs.size >= n) && ...));
+
+    auto f = Compile(eq.residual());
+    auto df = Compile(__Diff(eq.residual(), var));
+    f.sync();
+    df.sync();
+
+    /* __Diff gives the derivative times one unit of var */
+    const Real unit = RawTraits<T>::raw(One(T{}));
+    const Real lo0 = RawTraits<T>::raw(bracket.lower());
+    const Real hi0 = RawTraits<T>::raw(bracket.upper());
+    const Real nan = std::numeric_limits<Real>::quiet_NaN();
+
+    std::vector<Real> fRegs(f.registers() * BatchLanes);
+    std::vector<Real> dRegs(df.registers() * BatchLanes);
+    for (std::size_t r = 0 ; r < f.registers() ; r++)
+        SimdFill(fRegs.data() + r * BatchLanes, f.regs()[r], BatchLanes);
+    for (std::size_t r = 0 ; r < df.registers() ; r++)
+        SimdFill(dRegs.data() + r * BatchLanes, df.regs()[r], BatchLanes);
+
+    auto fSlot = f.findSlot(&var);
+    auto dSlot = df.findSlot(&var);
+    Real* fx = fSlot == TapeCode::npos ? nullptr : fRegs.data() + fSlot * BatchLanes;
+    Real* dx = dSlot == TapeCode::npos ? nullptr : dRegs.data() + dSlot * BatchLanes;
+    const Real* fy = fRegs.data() + f.result() * BatchLanes;
+    const Real* dy = dRegs.data() + df.result() * BatchLanes;
+
+    Real x[BatchLanes], lo[BatchLanes], hi[BatchLanes], fLo[BatchLanes];
+    bool active[BatchLanes], solved[BatchLanes];
+    std::size_t count = 0;
+
+    auto evaluate = [&](std::size_t lanes)
+    {
+        if (fx)
+            std::copy(x, x + lanes, fx);
+        TapeRunLanes(f, fRegs.data(), lanes);
+    };
+
+    for (std::size_t offset = 0 ; offset < n ; offset += BatchLanes)
+    {
+        std::size_t lanes = std::min(BatchLanes, n - offset);
+        (__LoadLanes(f, fRegs.data(), inputs, offset, lanes), ...);
+        (__LoadLanes(df, dRegs.data(), inputs, offset, lanes), ...);
+
+        /* The residual at both ends of the bracket, oriented so that
+         * it's negative at lo.
+         */
+        std::fill(x, x + lanes, lo0);
+        evaluate(lanes);
+        std::copy(fy, fy + lanes, fLo);
+        std::fill(x, x + lanes, hi0);
+        evaluate(lanes);
+
+        std::size_t remaining = 0;
+        for (std::size_t i = 0 ; i < lanes ; i++)
+        {
+            Real a = fLo[i], b = fy[i];
+            solved[i] = (a == 0) || (b == 0);
+            active[i] = !solved[i] && ((a < 0) != (b < 0));
+            lo[i] = (a < 0) ? lo0 : hi0;
+            hi[i] = (a < 0) ? hi0 : lo0;
+            x[i] = (a == 0) ? lo0 : (b == 0) ? hi0 : (lo0 + hi0) / 2;
+            remaining += active[i];
+        }
+
+        for (std::size_t iter = 0 ; remaining && iter < SolveIterations ; iter++)
+        {
+            evaluate(lanes);
+            if (dx)
+                std::copy(x, x + lanes, dx);
+            TapeRunLanes(df, dRegs.data(), lanes);
+
+            for (std::size_t i = 0 ; i < lanes ; i++)
+            {
+                if (!active[i])
+                    continue;
+
+                Real y = fy[i];
+                if (y == 0)
+                {
+                    active[i] = false;
+                    solved[i] = true;
+                    remaining--;
+                    continue;
+                }
+                if (y < 0)
+                    lo[i] = x[i];
+                else
+                    hi[i] = x[i];
+
+                /* A Newton step that small means x is already there, even
+                 * if rounding puts it on the edge of the bracket.
+                 */
+                Real step = y * unit / dy[i];
+                Real tol = SolveTolerance * (1 + fabs(x[i]));
+                Real next = x[i] - step;
+                Real a = std::min(lo[i], hi[i]), b = std::max(lo[i], hi[i]);
+                bool done = isfinite(next) && fabs(step) <= tol;
+                if (!done && !(next > a && next < b))
+                {
+                    next = (lo[i] + hi[i]) / 2;
+                    done = (b - a) <= tol;
+                }
+                x[i] = next;
+                if (done)
+                {
+                    active[i] = false;
+                    solved[i] = true;
+                    remaining--;
+                }
+            }
+        }
+
+        for (std::size_t i = 0 ; i < lanes ; i++)
+        {
+            out[offset + i] = RawTraits<T>::from(solved[i] ? x[i] : nan);
+            count += solved[i];
+        }
+    }
+
+    return count;
+}
+
+template<class Exp, typename T, class Out, typename... Ts>
+std::size_t SolveBatch(const Equation<Exp>& eq, Var<T>& var, Interval<T> bracket,
+                       Out& out, BatchInput<Ts>... inputs)
+{
+    return SolveBatch(eq, var, bracket, out.data(), out.size(), inputs...);
+}
+
+/* Solves an equation for var within a bracket, with the other variables
+ * at their current values. Gives nothing if there's no sign change in
+ * the bracket or it didn't converge.
+ */
+template<class Exp, typename T>
+std::optional<T> Solve(const Equation<Exp>& eq, Var<T>& var, Interval<T> bracket)
+{
+    T root;
+    if (SolveBatch(eq, var, bracket, &root, 1) == 0)
+        return std::nullopt;
+    return root;
+}
+
+} // namespace frogs
+
+#endif // _FROGS_SOLVE_H
@@ -0,0 +1,756 @@
+#ifndef _FROGS_TAPE_H
+#define _FROGS_TAPE_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cassert>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <math.h>
+
+#include "frogs_primitives.h"
+#include "frogs_types_creator.h"
+#include "frogs_types_fallback.h"
+#include "frogs_expressions.h"
+
+namespace frogs
+{
+
+/* The tape works on plain Reals. Every value that flows through it is
+ * converted to the raw scalar of its type and back again at the end.
+ * Each physical type is stored in its base unit, so the raw scalar is
+ * just the value divided by one unit of the same type.
+ */
+
+template<typename T, typename = void>
+struct RawTraits
+{
+    static constexpr bool supported = false;
+};
+
+template<typename T>
+struct RawTraits<T, std::enable_if_t<std::is_arithmetic_v<T>>>
+{
+    static constexpr bool supported = true;
+    static constexpr T unit() { return 1; }
+    static constexpr Real raw(T v) { return v; }
+    static constexpr T from(Real v) { return static_cast<T>(v); }
+};
+
+/* Units kept in a Fixed aren't supported. A Real only holds their count
+ * exactly up to 2^53, and they're kept in a Fixed to be exact.
+ */
+template<int P, template<int...> class C, typename S>
+struct RawTraits<Unit<P,C,S>>
+{
+    static constexpr bool supported = std::is_floating_point_v<S>;
+    static constexpr Unit<P,C,S> unit() { return Unit<P,C,S>::unit(); }
+    static constexpr Real raw(Unit<P,C,S> v) { return static_cast<Real>(v.raw()); }
+    static constexpr Unit<P,C,S> from(Real v) { return Unit<P,C,S>::fromRaw(static_cast<S>(v)); }
+};
+
+/* Products and quotients of units that don't have a class of their own
+ * are glued together by UnitsMul and UnitsDiv. Their raw value is the
+ * product or quotient of the raw values of both parts.
+ */
+
+template<class A, class B>
+struct RawTraits<UnitsMul<A,B,0>>
+{
+    static constexpr bool supported = RawTraits<A>::supported && RawTraits<B>::supported;
+    static constexpr UnitsMul<A,B,0> unit() { return {RawTraits<A>::unit(), RawTraits<B>::unit()}; }
+    static constexpr Real raw(UnitsMul<A,B,0> v) { return RawTraits<A>::raw(v.m_a) * RawTraits<B>::raw(v.m_b); }
+    static constexpr UnitsMul<A,B,0> from(Real v) { return {RawTraits<A>::from(v), RawTraits<B>::unit()}; }
+};
+
+template<class A, class B>
+struct RawTraits<UnitsDiv<A,B,0>>
+{
+    static constexpr bool supported = RawTraits<A>::supported && RawTraits<B>::supported;
+    static constexpr UnitsDiv<A,B,0> unit() { return {RawTraits<A>::unit(), RawTraits<B>::unit()}; }
+    static constexpr Real raw(UnitsDiv<A,B,0> v) { return RawTraits<A>::raw(v.m_a) / RawTraits<B>::raw(v.m_b); }
+    static constexpr UnitsDiv<A,B,0> from(Real v) { return {RawTraits<A>::from(v), RawTraits<B>::unit()}; }
+};
+
+/* A quantity's raw value is its value in the base units */
+template<int L, int M, int T, int A, int Px>
+struct RawTraits<Quantity<L,M,T,A,Px>>
+{
+    static constexpr bool supported = true;
+    static constexpr Quantity<L,M,T,A,Px> unit() { return Quantity<L,M,T,A,Px>::unit(); }
+    static constexpr Real raw(Quantity<L,M,T,A,Px> v) { return v.raw(); }
+    static constexpr Quantity<L,M,T,A,Px> from(Real v) { return Quantity<L,M,T,A,Px>::fromRaw(v); }
+};
+
+/* The operations a tape is made of. All of them read one or two
+ * registers and write a new one.
+ */
+
+enum class TapeOp : std::uint8_t
+{
+    Add, Sub, Mul, Div, Scale, Neg, Abs, Sqrt, Sqr, Cube,
+    Cos, Sin, Tan, ACos, ASin, ATan, ATan2
+};
+
+struct TapeInstr
+{
+    TapeOp op;
+    std::uint32_t dst;
+    std::uint32_t a;
+    std::uint32_t b;
+    Real k;
+};
+
+inline Real TapeApply(TapeOp op, Real a, Real b, Real k)
+{
+    switch (op)
+    {
+    case TapeOp::Add:   return a + b;
+    case TapeOp::Sub:   return a - b;
+    case TapeOp::Mul:   return a * b;
+    case TapeOp::Div:   return a / b;
+    case TapeOp::Scale: return k * a;
+    case TapeOp::Neg:   return -a;
+    case TapeOp::Abs:   return fabs(a);
+    case TapeOp::Sqrt:  return sqrt(a);
+    case TapeOp::Sqr:   return a * a;
+    case TapeOp::Cube:  return a * a * a;
+    case TapeOp::Cos:   return cos(a);
+    case TapeOp::Sin:   return sin(a);
+    case TapeOp::Tan:   return tan(a);
+    case TapeOp::ACos:  return acos(a);
+    case TapeOp::ASin:  return asin(a);
+    case TapeOp::ATan:  return atan(a);
+    case TapeOp::ATan2: return atan2(a, b);
+    }
+    return 0.0;
+}
+
+/* A slot is a register that's filled from a variable. The reader knows
+ * the type of the variable and converts its value to a raw Real.
+ */
+struct TapeSlotInfo
+{
+    void* var;
+    Real (*read)(void*);
+    std::uint64_t (*version)(void*);
+    std::uint32_t reg;
+};
+
+template<typename T>
+struct __VarAccess
+{
+    static Real read(void* v) { return RawTraits<T>::raw(static_cast<Var<T>*>(v)->val()); }
+    static std::uint64_t version(void* v) { return static_cast<Var<T>*>(v)->version(); }
+};
+
+/* A typed handle to one of the input slots of a tape. It's used to feed
+ * values into the tape directly without going through the variable.
+ */
+template<typename T>
+struct TapeSlot
+{
+    std::uint32_t reg;
+};
+
+/* What's in a register: the value of a variable, a constant, or the
+ * result of one of the instructions.
+ */
+enum class TapeRegKind : std::uint8_t { Slot, Constant, Instr };
+
+/* How far a tape goes when it simplifies. Exact only does what gives
+ * the same result as the expression for every input. Algebraic also
+ * treats the Reals as real numbers, for tapes that are shorter but may
+ * round differently.
+ */
+enum class TapeFolding : std::uint8_t { Exact, Algebraic };
+
+struct TapeRegInfo
+{
+    TapeRegKind kind;
+    std::uint32_t instr;
+};
+
+/* This is the untyped part of a compiled expression. The register file
+ * holds the input slots, the constants and the result of every
+ * instruction. Instructions are kept in evaluation order.
+ */
+class TapeCode
+{
+protected:
+    std::vector<TapeInstr> m_code;
+    std::vector<Real> m_regs;
+    std::vector<TapeRegInfo> m_info;
+    std::vector<TapeSlotInfo> m_slots;
+    std::uint32_t m_result = 0;
+    TapeFolding m_folding = TapeFolding::Exact;
+    /* Reals are keyed on their bits. -0 and +0 compare equal but don't
+     * give the same results, and NaNs don't compare at all.
+     */
+    std::map<std::uint64_t, std::uint32_t> m_constants;
+    std::map<std::tuple<std::uint8_t, std::uint32_t, std::uint32_t, std::uint64_t>, std::uint32_t> m_shared;
+
+    static std::uint64_t bits(Real v)
+    {
+        static_assert(sizeof(Real) == sizeof(std::uint64_t), "Reals are keyed as 64 bits");
+        std::uint64_t b;
+        std::memcpy(&b, &v, sizeof(b));
+        return b;
+    }
+
+    std::uint32_t addReg(Real v, TapeRegKind kind, std::uint32_t instr = 0)
+    {
+        m_regs.push_back(v);
+        m_info.push_back({kind, instr});
+        return m_regs.size() - 1;
+    }
+
+    /* Appends an instruction as is, unless the same one is already there */
+    std::uint32_t push(TapeOp op, std::uint32_t a, std::uint32_t b, Real k)
+    {
+        /* Unary operations don't read b */
+        if (!isBinary(op))
+            b = 0;
+        /* Same operands in a different order are the same node */
+        if ((op == TapeOp::Add || op == TapeOp::Mul) && b < a)
+            std::swap(a, b);
+        auto key = std::make_tuple(static_cast<std::uint8_t>(op), a, b, bits(k));
+        auto found = m_shared.find(key);
+        if (found != m_shared.end())
+            return found->second;
+        std::uint32_t dst = addReg(0.0, TapeRegKind::Instr, m_code.size());
+        m_code.push_back({op, dst, a, b, k});
+        m_shared[key] = dst;
+        return dst;
+    }
+
+    /* Splits a register into a coefficient times a base register, so
+     * that like terms can be combined.
+     */
+    std::pair<std::uint32_t, Real> term(std::uint32_t reg) const
+    {
+        if (m_info[reg].kind == TapeRegKind::Instr)
+        {
+            auto& i = m_code[m_info[reg].instr];
+            if (i.op == TapeOp::Scale)
+                return {i.a, i.k};
+            if (i.op == TapeOp::Neg)
+                return {i.a, -1.0};
+        }
+        return {reg, 1.0};
+    }
+
+    std::uint32_t scaled(std::uint32_t reg, Real k)
+    {
+        if (k == 0.0 && m_folding == TapeFolding::Algebraic)
+            return constant(0.0);
+        return emit(TapeOp::Scale, reg, 0, k);
+    }
+
+public:
+    static constexpr bool isBinary(TapeOp op)
+    {
+        return op == TapeOp::Add || op == TapeOp::Sub || op == TapeOp::Mul
+            || op == TapeOp::Div || op == TapeOp::ATan2;
+    }
+
+    bool isConstant(std::uint32_t reg) const { return m_info[reg].kind == TapeRegKind::Constant; }
+    bool isConstant(std::uint32_t reg, Real v) const { return isConstant(reg) && m_regs[reg] == v; }
+    bool isExactly(std::uint32_t reg, Real v) const { return isConstant(reg) && bits(m_regs[reg]) == bits(v); }
+
+    TapeFolding folding() const { return m_folding; }
+    void setFolding(TapeFolding folding) { m_folding = folding; }
+
+    std::uint32_t slotOf(void* var, Real (*read)(void*), std::uint64_t (*version)(void*))
+    {
+        for (auto& slot : m_slots)
+            if (slot.var == var)
+                return slot.reg;
+        m_slots.push_back({var, read, version, addReg(0.0, TapeRegKind::Slot)});
+        return m_slots[m_slots.size() - 1].reg;
+    }
+
+    /* Constants and instructions are hash-consed. Asking for one that's
+     * already on the tape returns the same register, so a subtree that
+     * appears several times in an expression is only evaluated once.
+     */
+    std::uint32_t constant(Real v)
+    {
+        auto found = m_constants.find(bits(v));
+        if (found != m_constants.end())
+            return found->second;
+        std::uint32_t reg = addReg(v, TapeRegKind::Constant);
+        m_constants[bits(v)] = reg;
+        return reg;
+    }
+
+    /* Emits an instruction after simplifying it. Operations on constants
+     * are folded, and so are the identities that give the same bits for
+     * every input: x*1, x/1, x+(-0), x-0, -(-x), x+x into 2*x, x*x into a
+     * square, and dividing by a power of two into a multiplication. With
+     * TapeFolding::Algebraic it also drops 0*x, 0/x and x-x, merges chained
+     * factors and combines like terms, which can change the rounding and
+     * what infinities and NaNs turn into. The result may be an existing
+     * register, so dead instructions can be left behind, which compact()
+     * takes care of.
+     */
+    std::uint32_t emit(TapeOp op, std::uint32_t a, std::uint32_t b = 0, Real k = 1.0)
+    {
+        bool binary = isBinary(op);
+        if (isConstant(a) && (!binary || isConstant(b)))
+            return constant(TapeApply(op, m_regs[a], binary ? m_regs[b] : 0.0, k));
+
+        bool algebraic = m_folding == TapeFolding::Algebraic;
+        switch (op)
+        {
+        case TapeOp::Add:
+        case TapeOp::Sub:
+        {
+            Real sign = (op == TapeOp::Add) ? 1.0 : -1.0;
+            /* x+(-0) and x-0 are x even when x is -0 */
+            if (isExactly(b, -sign * 0.0))
+                return a;
+            if (op == TapeOp::Add && isExactly(a, -0.0))
+                return b;
+            if (op == TapeOp::Add && a == b)
+                return scaled(a, 2.0);
+            if (!algebraic)
+                break;
+            if (isConstant(b, 0.0))
+                return a;
+            if (isConstant(a, 0.0))
+                return scaled(b, sign);
+            auto ta = term(a);
+            auto tb = term(b);
+            if (ta.first == tb.first)
+                return scaled(ta.first, ta.second + sign * tb.second);
+            break;
+        }
+        case TapeOp::Mul:
+            if (isConstant(b))
+                std::swap(a, b);
+            if (isConstant(a))
+                return scaled(b, m_regs[a]);
+            if (a == b)
+                return emit(TapeOp::Sqr, a);
+            break;
+        case TapeOp::Div:
+        {
+            if (algebraic && isConstant(a, 0.0))
+                return a;
+            int exp;
+            /* Dividing by a power of two is exactly a multiplication, as
+             * long as its inverse is a power of two as well.
+             */
+            if (isConstant(b) && frexp(m_regs[b], &exp) == 0.5 && 1.0 / (1.0 / m_regs[b]) == m_regs[b])
+                return scaled(a, 1.0 / m_regs[b]);
+            if (isConstant(b) && m_regs[b] == -1.0)
+                return emit(TapeOp::Neg, a);
+            break;
+        }
+        case TapeOp::Scale:
+        {
+            /* Merging two factors rounds once instead of twice, unless
+             * one of them only flips the sign.
+             */
+            auto t = term(a);
+            if (!algebraic && fabs(t.second) != 1.0 && fabs(k) != 1.0)
+                t = {a, 1.0};
+            Real total = t.second * k;
+            if (total == 1.0)
+                return t.first;
+            if (total == -1.0)
+                return push(TapeOp::Neg, t.first, 0, 1.0);
+            if (algebraic && total == 0.0)
+                return constant(0.0);
+            return push(TapeOp::Scale, t.first, 0, total);
+        }
+        case TapeOp::Neg:
+            return scaled(a, -1.0);
+        default:
+            break;
+        }
+        return push(op, a, b, k);
+    }
+
+    /* Removes the instructions that the result doesn't depend on and
+     * renumbers the registers. Slots are always kept.
+     */
+    void compact()
+    {
+        std::vector<bool> live(m_regs.size(), false);
+        live[m_result] = true;
+        for (std::size_t n = m_code.size() ; n > 0 ; n--)
+        {
+            auto& i = m_code[n - 1];
+            if (!live[i.dst])
+                continue;
+            live[i.a] = true;
+            if (isBinary(i.op))
+                live[i.b] = true;
+        }
+
+        TapeCode out;
+        out.m_folding = m_folding;
+        std::vector<std::uint32_t> map(m_regs.size(), npos);
+        for (auto& slot : m_slots)
+            map[slot.reg] = out.slotOf(slot.var, slot.read, slot.version);
+        for (std::uint32_t r = 0 ; r < m_regs.size() ; r++)
+            if (live[r] && isConstant(r))
+                map[r] = out.constant(m_regs[r]);
+        for (auto& i : m_code)
+            if (live[i.dst])
+                map[i.dst] = out.push(i.op, map[i.a], isBinary(i.op) ? map[i.b] : 0, i.k);
+        out.m_result = map[m_result];
+        *this = std::move(out);
+    }
+
+    /* Turns the slots of some variables into constants holding their
+     * current values and emits the instructions again. Everything that
+     * only depended on them folds into constants, and the tape no longer
+     * reads them.
+     */
+    void freeze(const void* const* vars, std::size_t count)
+    {
+        TapeCode out;
+        out.m_folding = m_folding;
+        std::vector<std::uint32_t> map(m_regs.size(), npos);
+        for (auto& slot : m_slots)
+        {
+            if (std::find(vars, vars + count, slot.var) != vars + count)
+                map[slot.reg] = out.constant(slot.read(slot.var));
+            else
+                map[slot.reg] = out.slotOf(slot.var, slot.read, slot.version);
+        }
+        for (std::uint32_t r = 0 ; r < m_regs.size() ; r++)
+            if (isConstant(r))
+                map[r] = out.constant(m_regs[r]);
+        for (auto& i : m_code)
+            map[i.dst] = out.emit(i.op, map[i.a], isBinary(i.op) ? map[i.b] : 0, i.k);
+        out.m_result = map[m_result];
+        out.compact();
+        *this = std::move(out);
+    }
+
+    /* Returns the register of a variable's slot, or npos if the tape
+     * doesn't depend on that variable.
+     */
+    std::uint32_t findSlot(const void* var) const
+    {
+        for (auto& slot : m_slots)
+            if (slot.var == var)
+                return slot.reg;
+        return npos;
+    }
+
+    void setResult(std::uint32_t reg) { m_result = reg; }
+
+    static constexpr std::uint32_t npos = ~std::uint32_t{0};
+
+    /* Reads the current values of all the variables into their slots */
+    void sync() { sync(m_regs.data()); }
+
+    /* Runs the instructions on whatever is in the slots now */
+    Real run() { return run(m_regs.data()); }
+
+    /* The same on a register file that's kept outside of the tape, which
+     * starts as a copy of regs(). These don't change the tape, so several
+     * threads can run it at once, each on its own registers.
+     */
+    void sync(Real* r) const
+    {
+        for (auto& slot : m_slots)
+            r[slot.reg] = slot.read(slot.var);
+    }
+
+    Real run(Real* r) const
+    {
+        for (auto& i : m_code)
+            r[i.dst] = TapeApply(i.op, r[i.a], r[i.b], i.k);
+        return r[m_result];
+    }
+
+    std::size_t size() const { return m_code.size(); }
+    std::size_t nodes() const { return m_slots.size() + m_constants.size() + m_code.size(); }
+    std::size_t registers() const { return m_regs.size(); }
+    std::size_t slots() const { return m_slots.size(); }
+
+    const std::vector<TapeInstr>& code() const { return m_code; }
+    const std::vector<Real>& regs() const { return m_regs; }
+    std::uint32_t result() const { return m_result; }
+
+    void appendTo(Str& out) const
+    {
+        out += "tape[";
+        append2str(out, static_cast<Integer>(m_code.size()));
+        out += " ops, ";
+        append2str(out, static_cast<Integer>(m_constants.size()));
+        out += " constants, ";
+        append2str(out, static_cast<Integer>(m_slots.size()));
+        out += " slots]";
+    }
+
+    Str toString() const { Str s; appendTo(s); return s; }
+};
+
+/* A compiled expression of result type R. Evaluating it with $() reads
+ * the variables it was compiled from. For the hot path, feed the slots
+ * with set() and call run() instead.
+ */
+template<typename R>
+class Tape : public TapeCode
+{
+public:
+    template<typename T>
+    TapeSlot<T> slot(Var<T>& var)
+    {
+        static_assert(RawTraits<T>::supported, "Variable type can't be compiled");
+        return {slotOf(&var, __VarAccess<T>::read, __VarAccess<T>::version)};
+    }
+
+    template<typename T>
+    void set(TapeSlot<T> slot, T v) { m_regs[slot.reg] = RawTraits<T>::raw(v); }
+
+    R run() { return RawTraits<R>::from(TapeCode::run()); }
+    R val() { sync(); return run(); }
+    R operator()() { return val(); }
+
+    friend std::ostream &operator<<(std::ostream &output, const Tape& obj)
+    {
+        return __Print(output, obj);
+    }
+};
+
+/* Values for the variables of a tape that are kept apart from both the
+ * tape and the variables. A tape is shared by any number of these, so
+ * one compiled expression can be evaluated for many entities, or from
+ * many threads, each with its own inputs:
+ *
+ * Bindings<Distance> env{tape};
+ * env.set(t, 3_sec);
+ * Distance d = env.run();
+ *
+ * The tape has to outlive its bindings.
+ */
+template<typename R>
+class Bindings
+{
+protected:
+    const TapeCode* m_tape;
+    std::vector<Real> m_regs;
+
+public:
+    Bindings(const Tape<R>& tape) : m_tape{&tape}, m_regs{tape.regs()} {}
+
+    /* The slot of a variable, for setting it without looking it up */
+    template<typename T>
+    TapeSlot<T> slot(const Var<T>& var) const
+    {
+        auto reg = m_tape->findSlot(&var);
+        assert(reg != TapeCode::npos);
+        return {reg};
+    }
+
+    template<typename T>
+    void set(TapeSlot<T> slot, T v) { m_regs[slot.reg] = RawTraits<T>::raw(v); }
+
+    /* Variables that the tape doesn't read are ignored */
+    template<typename T>
+    void set(const Var<T>& var, T v)
+    {
+        auto reg = m_tape->findSlot(&var);
+        if (reg != TapeCode::npos)
+            m_regs[reg] = RawTraits<T>::raw(v);
+    }
+
+    /* Takes the current values of the variables themselves */
+    void sync() { m_tape->sync(m_regs.data()); }
+
+    R run() { return RawTraits<R>::from(m_tape->run(m_regs.data())); }
+    R operator()() { return run(); }
+};
+
+/* The emitters. Each one appends the instructions of a node to the tape
+ * and returns the register that holds its value.
+ */
+
+template<typename Exp>
+using ValueOf = std::decay_t<decltype($(std::declval<Exp&>()))>;
+
+template<typename T>
+std::uint32_t __Emit(TapeCode& tape, Var<T>* expr)
+{
+    static_assert(RawTraits<T>::supported, "Variable type can't be compiled");
+    return tape.slotOf(expr, __VarAccess<T>::read, __VarAccess<T>::version);
+}
+
+template<typename T>
+std::uint32_t __Emit(TapeCode& tape, Var<T>& expr)
+{
+    return __Emit(tape, &expr);
+}
+
+template<typename T>
+std::uint32_t __Emit(TapeCode& tape, Const<T,DummyClass> expr)
+{
+    static_assert(RawTraits<T>::supported, "Constant type can't be compiled");
+    return tape.constant(RawTraits<T>::raw(expr.val()));
+}
+
+template<typename T>
+std::uint32_t __Emit(TapeCode& tape, SubstExp<T,DummyClass> expr)
+{
+    if (expr.bound())
+        return tape.constant(RawTraits<T>::raw(expr.val()));
+    return __Emit(tape, expr.var());
+}
+
+template<typename T>
+std::uint32_t __Emit(TapeCode& tape, ZeroExp<T,DummyClass> expr)
+{
+    return tape.constant(0.0);
+}
+
+/* Functions of one argument map the raw value directly, since all the
+ * units are stored in their base unit.
+ */
+#define DECL_TAPE_1(ClassName, Op) \
+template<typename Exp> \
+std::uint32_t __Emit(TapeCode& tape, ClassName<Exp,DummyClass> expr) \
+{ \
+    static_assert(RawTraits<ValueOf<ClassName<Exp,DummyClass>>>::supported, \
+                  "Sub-expression type can't be compiled"); \
+    return tape.emit(TapeOp::Op, __Emit(tape, expr.arg())); \
+}
+
+/* Multiplying or dividing two different units may involve a scale
+ * factor (like grams to kilograms). It's the raw value of the result
+ * of applying the operator on one unit of each, and it's computed at
+ * compile time.
+ */
+#define DECL_TAPE_2(ClassName, Op, Func) \
+template<class Exp0, class Exp1> \
+std::uint32_t __Emit(TapeCode& tape, ClassName<Exp0,Exp1> expr) \
+{ \
+    using R = ValueOf<ClassName<Exp0,Exp1>>; \
+    using A = ValueOf<Exp0>; \
+    using B = ValueOf<Exp1>; \
+    static_assert(RawTraits<R>::supported, "Sub-expression type can't be compiled"); \
+    constexpr Real k = RawTraits<R>::raw(Func(RawTraits<A>::unit(), RawTraits<B>::unit())); \
+    auto a = __Emit(tape, expr.first()); \
+    auto b = __Emit(tape, expr.second()); \
+    auto result = tape.emit(TapeOp::Op, a, b); \
+    if (k != 1.0) \
+        result = tape.emit(TapeOp::Scale, result, 0, k); \
+    return result; \
+}
+
+template<class Exp0, class Exp1>
+std::uint32_t __Emit(TapeCode& tape, Add<Exp0,Exp1> expr)
+{
+    static_assert(std::is_same_v<ValueOf<Exp0>, ValueOf<Exp1>>, "Can only compile additions of the same type");
+    static_assert(RawTraits<ValueOf<Exp0>>::supported, "Sub-expression type can't be compiled");
+    auto a = __Emit(tape, expr.first());
+    auto b = __Emit(tape, expr.second());
+    return tape.emit(TapeOp::Add, a, b);
+}
+
+template<class Exp0, class Exp1>
+std::uint32_t __Emit(TapeCode& tape, Sub<Exp0,Exp1> expr)
+{
+    static_assert(std::is_same_v<ValueOf<Exp0>, ValueOf<Exp1>>, "Can only compile subtractions of the same type");
+    static_assert(RawTraits<ValueOf<Exp0>>::supported, "Sub-expression type can't be compiled");
+    auto a = __Emit(tape, expr.first());
+    auto b = __Emit(tape, expr.second());
+    return tape.emit(TapeOp::Sub, a, b);
+}
+
+template<class Exp0, class Exp1>
+std::uint32_t __Emit(TapeCode& tape, ATan2Exp<Exp0,Exp1> expr)
+{
+    static_assert(std::is_same_v<ValueOf<Exp0>, ValueOf<Exp1>>, "Can only compile ATan2 of the same type");
+    auto a = __Emit(tape, expr.first());
+    auto b = __Emit(tape, expr.second());
+    return tape.emit(TapeOp::ATan2, a, b);
+}
+
+template<class Exp>
+std::uint32_t __Emit(TapeCode& tape, Pos<Exp,DummyClass> expr)
+{
+    return __Emit(tape, expr.arg());
+}
+
+DECL_TAPE_2(Mul, Mul, MulFunc)
+DECL_TAPE_2(Div, Div, DivFunc)
+DECL_TAPE_1(Neg, Neg)
+DECL_TAPE_1(AbsExp, Abs)
+DECL_TAPE_1(SqrtExp, Sqrt)
+DECL_TAPE_1(SqrExp, Sqr)
+DECL_TAPE_1(CubeExp, Cube)
+DECL_TAPE_1(CosExp, Cos)
+DECL_TAPE_1(SinExp, Sin)
+DECL_TAPE_1(TanExp, Tan)
+DECL_TAPE_1(ACosExp, ACos)
+DECL_TAPE_1(ASinExp, ASin)
+DECL_TAPE_1(ATanExp, ATan)
+
+/* Compiles an expression into a flat tape. The expression has to be
+ * made of Reals and physical units only, which is checked at compile
+ * time. The variables are still referenced by the tape, so they have to
+ * outlive it the same way they do the expression. By default the tape
+ * gives the same results as $() on the expression, bit for bit. Passing
+ * TapeFolding::Algebraic lets it simplify further.
+ */
+template<typename Exp>
+auto Compile(Exp&& expr, TapeFolding folding = TapeFolding::Exact)
+{
+    using R = ValueOf<std::remove_reference_t<Exp>>;
+    static_assert(RawTraits<R>::supported, "Expression type can't be compiled");
+    Tape<R> tape;
+    tape.setFolding(folding);
+    tape.setResult(__Emit(tape, expr));
+    tape.compact();
+    return tape;
+}
+
+/* Functions that work on tapes also accept expressions, which they
+ * compile on the spot. Passing a tape that's already compiled saves
+ * that step when it's called repeatedly.
+ */
+template<typename R>
+Tape<R>& __TapeOf(Tape<R>& tape) { return tape; }
+
+/* Running a tape writes to its registers, so a const one is copied */
+template<typename R>
+Tape<R> __TapeOf(const Tape<R>& tape) { return tape; }
+
+template<typename R>
+Tape<R> __TapeOf(Tape<R>&& tape) { return std::move(tape); }
+
+template<typename Exp>
+auto __TapeOf(Exp&& expr) { return Compile(expr); }
+
+/* Partial evaluation. The variables given are taken at their current
+ * values, and whatever depends only on them is worked out once. The
+ * result is a tape that reads the other variables only:
+ *
+ * auto perTick = Specialize(force, mass, radius);
+ *
+ * It has to be specialized again if one of the frozen variables changes.
+ */
+template<typename Exp, typename T, typename... Ts>
+auto Specialize(Exp&& expr, Var<T>& var, Var<Ts>&... vars)
+{
+    auto tape = __TapeOf(expr);
+    const void* frozen[] = {&var, &vars...};
+    tape.freeze(frozen, 1 + sizeof...(vars));
+    return tape;
+}
+
+} // namespace frogs
+
+#endif // _FROGS_TAPE_H
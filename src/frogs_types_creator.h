@@ -16,30 +16,83 @@
 
 namespace frogs
 {
-template<int P, template<int...> class T>
+/* What a unit does with its scalar when it's scaled by a Real, or when
+ * a Real is divided by it. Scalars that aren't floating point, like
+ * Fixed, have overloads of their own.
+ */
+template<typename S> constexpr S __Scale(S v, Real k) { return v * static_cast<S>(k); }
+template<typename S> constexpr S __Unscale(S v, Real k) { return v / static_cast<S>(k); }
+template<typename S> constexpr S __Inverse(Real a, S v) { return static_cast<S>(a) / v; }
+
+/* Whether every value of the scalar F is also one of S */
+template<typename F, typename S>
+constexpr bool __Widens()
+{
+    if constexpr (std::is_floating_point_v<F> && std::is_floating_point_v<S>)
+        return std::numeric_limits<F>::digits <= std::numeric_limits<S>::digits &&
+               std::numeric_limits<F>::max_exponent <= std::numeric_limits<S>::max_exponent;
+    else
+        return false;
+}
+
+/* A value of one of the classes, to the power P. It's kept as a scalar
+ * of type S in the base unit of the class. S is Real unless it's given,
+ * and a float halves the memory and the bandwidth of large arrays of
+ * units:
+ *
+ * Unit<1,DistanceT,float> d{1.5_m};    // narrowing has to be explicit
+ * Distance wide = d;                    // widening doesn't
+ *
+ * Units of the same class and different scalars can be added, compared
+ * and so on, and the result has the wider scalar of both. The
+ * conversions between classes, like Velocity * Time, are done on Reals.
+ * S can also be a Fixed, for values that have to be exact.
+ */
+template<int P, template<int...> class T, typename S = Real>
 class Unit
 {
+    static_assert(std::is_floating_point_v<S> || !std::is_arithmetic_v<S>,
+                  "Units are kept in a floating point scalar or a Fixed");
+
 private:
-    T<P> m_value;
+    S m_value;
+
+    template<typename F>
+    static constexpr bool widens = __Widens<F,S>();
 
 public:
-    using Self = Unit<P,T>;
+    using Self = Unit<P,T,S>;
+    using Scalar = S;
     constexpr Unit() : m_value{} {}
-    constexpr Unit(T<P> v) : m_value{v} {}
-    static constexpr Self zero() { return {T<P>::zero()}; }
-    static constexpr Self unit() { return {T<P>::unit()}; }
-    static constexpr Self max() { return {T<P>::max()}; }
-    static constexpr Self min() { return {T<P>::min()}; }
-    constexpr Self& operator+=(Self a) { m_value += $(a); return *this; }
-    constexpr Self& operator-=(Self a) { m_value -= $(a); return *this; }
-    constexpr Self& operator*=(Real a) { m_value *= a; return *this; }
-    constexpr Self& operator/=(Real a) { m_value *= a; return *this; }
-    constexpr Self& operator=(Self a) { m_value = $(a); return *this; }
+    constexpr Unit(T<P> v) : m_value{static_cast<S>(v / T<P>::unit())} {}
+
+    template<typename F, std::enable_if_t<!std::is_same_v<F,S> && widens<F>, int> = 0>
+    constexpr Unit(Unit<P,T,F> v) : m_value{v.raw()} {}
+
+    template<typename F, std::enable_if_t<!widens<F>, int> = 0>
+    explicit constexpr Unit(Unit<P,T,F> v) : m_value{static_cast<S>(v.raw())} {}
+
+    /* The value in the base unit of the class */
+    static constexpr Self fromRaw(S v) { Self u; u.m_value = v; return u; }
+    constexpr S raw() const { return m_value; }
+
+    static constexpr Self zero() { return fromRaw(static_cast<S>(0)); }
+    static constexpr Self unit() { return fromRaw(static_cast<S>(1)); }
+    static constexpr Self max() { return fromRaw(std::numeric_limits<S>::max()); }
+    /* The smallest positive value, and the most negative one is lowest() */
+    static constexpr Self min() { return fromRaw(std::numeric_limits<S>::min()); }
+    static constexpr Self lowest() { return fromRaw(std::numeric_limits<S>::lowest()); }
+    constexpr Self& operator+=(Self a) { m_value += a.m_value; return *this; }
+    constexpr Self& operator-=(Self a) { m_value -= a.m_value; return *this; }
+    constexpr Self& operator*=(Real a) { m_value = __Scale(m_value, a); return *this; }
+    constexpr Self& operator/=(Real a) { m_value = __Unscale(m_value, a); return *this; }
+    constexpr Self& operator=(Self a) { m_value = a.m_value; return *this; }
     constexpr auto operator,(Self other) { return Vec2{*this, other}; }
     constexpr auto operator,(Vec2<Self> other) { return Vec3{*this, other}; }
     constexpr auto operator,(Vec3<Self> other) { return Vec4{*this, other}; }
 
-    Str toString() const { return m_value.toString(); }
+    void appendTo(Str& out) const { T<P>::appendTo(out, m_value); }
+    Str toString() const { Str s; appendTo(s); return s; }
 
 #ifdef QT_VERSION
     friend QDebug operator<<(QDebug d, Self v) {
@@ -47,131 +100,108 @@ public:
         return d;
     }
 #endif
-
-    template<int N, template<int...> class C>
-    friend constexpr C<N> $(Unit<N,C> a);
 };
 
-template<int N, template<int...> class C>
-constexpr C<N> $(Unit<N,C> a)
-{ return a.m_value; }
+/* The value as an object of its class, which has the getters of the
+ * units. It's always a Real.
+ */
+template<int N, template<int...> class C, typename S>
+constexpr C<N> $(Unit<N,C,S> a)
+{ return {static_cast<Real>(a.raw())}; }
 
-template<int P, template<int...> class T>
-constexpr Unit<P,T> operator-(Unit<P,T> a)
-{ return {-$(a)}; }
+template<int P, template<int...> class T, typename S>
+constexpr Unit<P,T,S> operator-(Unit<P,T,S> a)
+{ return Unit<P,T,S>::fromRaw(-a.raw()); }
 
-template<int P, template<int...> class T>
-constexpr Unit<P,T> operator+(Unit<P,T> a)
+template<int P, template<int...> class T, typename S>
+constexpr Unit<P,T,S> operator+(Unit<P,T,S> a)
 { return a; }
 
-template<int P, template<int...> class T>
-constexpr Unit<P,T> operator+(Unit<P,T> a, Unit<P,T> b)
-{ return {$(a) + $(b)}; }
-
-template<int P, template<int...> class T>
-constexpr Unit<P,T> operator-(Unit<P,T> a, Unit<P,T> b)
-{ return {$(a) - $(b)}; }
+template<int P, template<int...> class T, typename SA, typename SB>
+constexpr auto operator+(Unit<P,T,SA> a, Unit<P,T,SB> b) -> Unit<P,T,decltype(a.raw() + b.raw())>
+{ return Unit<P,T,decltype(a.raw() + b.raw())>::fromRaw(a.raw() + b.raw()); }
 
-template<int P, template<int...> class T>
-constexpr Unit<P,T> operator*(Real a, Unit<P,T> b)
-{ return {a * $(b)}; }
+template<int P, template<int...> class T, typename SA, typename SB>
+constexpr auto operator-(Unit<P,T,SA> a, Unit<P,T,SB> b) -> Unit<P,T,decltype(a.raw() - b.raw())>
+{ return Unit<P,T,decltype(a.raw() - b.raw())>::fromRaw(a.raw() - b.raw()); }
 
-template<int P, template<int...> class T>
-constexpr Unit<P,T> operator*(Unit<P,T> a, Real b)
-{ return {$(a) * b}; }
+template<int P, template<int...> class T, typename S>
+constexpr Unit<P,T,S> operator*(Real a, Unit<P,T,S> b)
+{ return Unit<P,T,S>::fromRaw(__Scale(b.raw(), a)); }
 
-template<int P, template<int...> class T>
-constexpr Unit<P,T> operator/(Unit<P,T> a, Real b)
-{ return {$(a) / b}; }
+template<int P, template<int...> class T, typename S>
+constexpr Unit<P,T,S> operator*(Unit<P,T,S> a, Real b)
+{ return Unit<P,T,S>::fromRaw(__Scale(a.raw(), b)); }
 
-template<int P, template<int...> class T>
-constexpr Unit<-P,T> operator/(Real a, Unit<P,T> b)
-{ return {a / $(b)}; }
+template<int P, template<int...> class T, typename S>
+constexpr Unit<P,T,S> operator/(Unit<P,T,S> a, Real b)
+{ return Unit<P,T,S>::fromRaw(__Unscale(a.raw(), b)); }
 
-template<int N, int M, template<int...> class T>
-constexpr Unit<N+M,T> operator*(Unit<N,T> a, Unit<M,T> b)
-{ return {$(a) * $(b)}; }
+template<int P, template<int...> class T, typename S>
+constexpr auto operator/(Real a, Unit<P,T,S> b)
+{ return Unit<-P,T,decltype(__Inverse(a, b.raw()))>::fromRaw(__Inverse(a, b.raw())); }
 
-template<int N, int M, template<int...> class T>
-constexpr Unit<N-M,T> operator/(Unit<N,T> a, Unit<M,T> b)
-{ return {$(a) / $(b)}; }
+template<int N, int M, template<int...> class T, typename SA, typename SB>
+constexpr auto operator*(Unit<N,T,SA> a, Unit<M,T,SB> b) -> Unit<N+M,T,decltype(a.raw() * b.raw())>
+{ return Unit<N+M,T,decltype(a.raw() * b.raw())>::fromRaw(a.raw() * b.raw()); }
 
-template<int N, template<int...> class T>
-constexpr Real operator/(Unit<N,T> a, Unit<N,T> b)
-{ return $(a) / $(b); }
+template<int N, int M, template<int...> class T, typename SA, typename SB>
+constexpr auto operator/(Unit<N,T,SA> a, Unit<M,T,SB> b) -> Unit<N-M,T,decltype(a.raw() / b.raw())>
+{ return Unit<N-M,T,decltype(a.raw() / b.raw())>::fromRaw(a.raw() / b.raw()); }
 
-template<int N, template<int...> class T>
-constexpr bool operator==(Unit<N,T> a, Unit<N,T> b)
-{ return $(a) == $(b); }
+template<int N, template<int...> class T, typename SA, typename SB>
+constexpr auto operator/(Unit<N,T,SA> a, Unit<N,T,SB> b) -> decltype(a.raw() / b.raw())
+{ return a.raw() / b.raw(); }
 
-template<int N, template<int...> class T>
-constexpr bool operator!=(Unit<N,T> a, Unit<N,T> b)
-{ return $(a) != $(b); }
+#define DECL_UNIT_COMPARISON(Opr) \
+template<int N, template<int...> class T, typename SA, typename SB> \
+constexpr bool operator Opr(Unit<N,T,SA> a, Unit<N,T,SB> b) \
+{ return a.raw() Opr b.raw(); }
 
-template<int N, template<int...> class T>
-constexpr bool operator>(Unit<N,T> a, Unit<N,T> b)
-{ return $(a) > $(b); }
+DECL_UNIT_COMPARISON(==)
+DECL_UNIT_COMPARISON(!=)
+DECL_UNIT_COMPARISON(>)
+DECL_UNIT_COMPARISON(>=)
+DECL_UNIT_COMPARISON(<)
+DECL_UNIT_COMPARISON(<=)
 
-template<int N, template<int...> class T>
-constexpr bool operator>=(Unit<N,T> a, Unit<N,T> b)
-{ return $(a) >= $(b); }
+#undef DECL_UNIT_COMPARISON
 
-template<int N, template<int...> class T>
-constexpr bool operator<(Unit<N,T> a, Unit<N,T> b)
-{ return $(a) < $(b); }
+template<int N, template<int...> class T, typename S>
+constexpr Unit<N,T,S> Abs(Unit<N,T,S> v)
+{ return Unit<N,T,S>::fromRaw(Abs(v.raw())); }
 
-template<int N, template<int...> class T>
-constexpr bool operator<=(Unit<N,T> a, Unit<N,T> b)
-{ return $(a) <= $(b); }
+template<int N, template<int...> class T, typename S, typename = std::enable_if_t<N % 2 == 0>>
+constexpr auto Sqrt(Unit<N,T,S> v)
+{ return Unit<N/2,T,decltype(Sqrt(v.raw()))>::fromRaw(Sqrt(v.raw())); }
 
-template<int N, template<int...> class T>
-constexpr Unit<N,T> Abs(Unit<N,T> v)
-{ return {Abs($(v))}; }
+template<int N, template<int...> class T, typename S>
+constexpr auto Sqr(Unit<N,T,S> v)
+{ return Unit<N*2,T,decltype(Sqr(v.raw()))>::fromRaw(Sqr(v.raw())); }
 
-template<template<int...> class T>
-constexpr Unit<1,T> Sqrt(Unit<2,T> v)
-{ return {Sqrt($(v))}; }
+template<int N, template<int...> class T, typename S>
+constexpr auto Cube(Unit<N,T,S> v)
+{ return Unit<N*3,T,decltype(Cube(v.raw()))>::fromRaw(Cube(v.raw())); }
 
-template<template<int...> class T>
-constexpr Unit<2,T> Sqrt(Unit<4,T> v)
-{ return {Sqrt($(v))}; }
+template<int N, template<int...> class T, typename S>
+constexpr Unit<N,T,S> One(Unit<N,T,S>&)
+{ return Unit<N,T,S>::unit(); }
 
-template<template<int...> class T>
-constexpr Unit<3,T> Sqrt(Unit<6,T> v)
-{ return {Sqrt($(v))}; }
+template<int N, template<int...> class T, typename S>
+constexpr Unit<N,T,S> One(Unit<N,T,S>&&)
+{ return Unit<N,T,S>::unit(); }
 
-template<template<int...> class T>
-constexpr Unit<4,T> Sqrt(Unit<8,T> v)
-{ return {Sqrt($(v))}; }
+template<int N, template<int...> class T, typename S>
+constexpr Unit<N,T,S> Zero(Unit<N,T,S>&)
+{ return Unit<N,T,S>::zero(); }
 
-template<int N, template<int...> class T>
-constexpr Unit<N*2,T> Sqr(Unit<N,T> v)
-{ return {Sqr($(v))}; }
+template<int N, template<int...> class T, typename S>
+constexpr Unit<N,T,S> Zero(Unit<N,T,S>&&)
+{ return Unit<N,T,S>::zero(); }
 
-template<int N, template<int...> class T>
-constexpr Unit<N*3,T> Cube(Unit<N,T> v)
-{ return {Cube($(v))}; }
-
-template<int N, template<int...> class T>
-constexpr Unit<N,T> One(Unit<N,T>& a)
-{ return {One($(a))}; }
-
-template<int N, template<int...> class T>
-constexpr Unit<N,T> One(Unit<N,T>&& a)
-{ return {One($(a))}; }
-
-template<int N, template<int...> class T>
-constexpr Unit<N,T> Zero(Unit<N,T>& a)
-{ return {Zero($(a))}; }
-
-template<int N, template<int...> class T>
-constexpr Unit<N,T> Zero(Unit<N,T>&& a)
-{ return {Zero($(a))}; }
-
-template<int N, template<int...> class T>
-std::ostream &operator<<(std::ostream &output, Unit<N,T> obj) {
-    output << obj.toString();
-    return output;
+template<int N, template<int...> class T, typename S>
+std::ostream &operator<<(std::ostream &output, Unit<N,T,S> obj) {
+    return __Print(output, obj);
 }
 
 } // namespace frogs
@@ -269,6 +299,7 @@ public: \
     static constexpr Self unit() { return {1.0}; } \
     static constexpr Self max() { return {std::numeric_limits<Real>::max()}; } \
     static constexpr Self min() { return {std::numeric_limits<Real>::min()}; } \
+    static constexpr Self lowest() { return {std::numeric_limits<Real>::lowest()}; } \
     constexpr Self& operator+=(Self a) { m_value += a.m_value; return *this; } \
     constexpr Self& operator-=(Self a) { m_value -= a.m_value; return *this; } \
     constexpr Self& operator*=(Real a) { m_value *= a; return *this; } \
@@ -299,13 +330,18 @@ public: \
     template<int N> friend constexpr ClassName##T<N*2> Sqr(ClassName##T<N> v); \
     template<int N> friend constexpr ClassName##T<N*3> Cube(ClassName##T<N> v); \
     template<typename T> friend constexpr auto Diff(T); \
-    Str toString() const { \
-        return conv2str(m_value) + " " #String \
-        + ((P != 1) ? conv2str(P) : Str("")); } \
+    template<typename S> \
+    static void appendTo(Str& out, S v) { \
+        append2str(out, v); \
+        out += " " #String; \
+        if (P != 1) \
+            append2str(out, P); \
+    } \
+    void appendTo(Str& out) const { appendTo(out, m_value); } \
+    Str toString() const { Str s; appendTo(s); return s; } \
     PublicDecl \
     friend std::ostream &operator<<(std::ostream &output, const ClassName##T obj) { \
-        output << obj.toString(); \
-        return output; \
+        return __Print(output, obj); \
     } \
     template <int N> friend constexpr ClassName##T<N> One(ClassName##T<N>&); \
     template <int N> friend constexpr ClassName##T<N> One(ClassName##T<N>&&); \
@@ -336,10 +372,10 @@ public: \
     template<int N> constexpr bool operator<(ClassName##T<N> a, ClassName##T<N> b) { return {a.m_value < b.m_value}; } \
     template<int N> constexpr bool operator<=(ClassName##T<N> a, ClassName##T<N> b) { return {a.m_value <= b.m_value}; } \
     template<int N> constexpr ClassName##T<N> Abs(ClassName##T<N> v) { return (v.m_value < 0) ? -v : v; } \
-    constexpr ClassName##T<1> Sqrt(ClassName##T<2> v) { return {sqrt(v.m_value)}; } \
-    constexpr ClassName##T<2> Sqrt(ClassName##T<4> v) { return {sqrt(v.m_value)}; } \
-    constexpr ClassName##T<3> Sqrt(ClassName##T<6> v) { return {sqrt(v.m_value)}; } \
-    constexpr ClassName##T<4> Sqrt(ClassName##T<8> v) { return {sqrt(v.m_value)}; } \
+    constexpr ClassName##T<1> Sqrt(ClassName##T<2> v) { return {__Sqrt(v.m_value)}; } \
+    constexpr ClassName##T<2> Sqrt(ClassName##T<4> v) { return {__Sqrt(v.m_value)}; } \
+    constexpr ClassName##T<3> Sqrt(ClassName##T<6> v) { return {__Sqrt(v.m_value)}; } \
+    constexpr ClassName##T<4> Sqrt(ClassName##T<8> v) { return {__Sqrt(v.m_value)}; } \
     template<int N> constexpr ClassName##T<N*2> Sqr(ClassName##T<N> v) { return {v.m_value*v.m_value}; } \
     template<int N> constexpr ClassName##T<N*3> Cube(ClassName##T<N> v) { return {v.m_value*v.m_value*v.m_value}; } \
     template<int N> constexpr ClassName##T<N> One(ClassName##T<N>&) { return ClassName##T<N>::unit(); } \
@@ -1,6 +1,8 @@
 #ifndef _FROGS_TYPES_FALLBACK_H
 #define _FROGS_TYPES_FALLBACK_H
 
+#include <ostream>
+
 #include "frogs_primitives.h"
 
 namespace frogs
@@ -28,6 +30,18 @@ public:
     A m_a;
     B m_b;
     constexpr UnitsMul(A a, B b) : m_a{a}, m_b{b} {}
+    void appendTo(Str& out) const {
+        out += '(';
+        append2str(out, m_a);
+        out += " * ";
+        append2str(out, m_b);
+        out += ')';
+    }
+    Str toString() const { Str s; appendTo(s); return s; }
+
+    friend std::ostream &operator<<(std::ostream &output, const UnitsMul& obj) {
+        return __Print(output, obj);
+    }
 };
 
 /* And this one is for division */
@@ -38,21 +52,27 @@ public:
     A m_a;
     B m_b;
     constexpr UnitsDiv(A a, B b) : m_a{a}, m_b{b} {}
+    void appendTo(Str& out) const {
+        out += '(';
+        append2str(out, m_a);
+        out += " / ";
+        append2str(out, m_b);
+        out += ')';
+    }
+    Str toString() const { Str s; appendTo(s); return s; }
+
+    friend std::ostream &operator<<(std::ostream &output, const UnitsDiv& obj) {
+        return __Print(output, obj);
+    }
 };
 
-/* These are the main operators that create objects of these
- * classes. If there are already explicit operators for the
- * types being multiplied or divided, the compiler will chose
- * that overload instead. Otherwise if it's not defined, the
- * choice will fall back to these.
+/* The main operators that create objects of these classes are
+ * in frogs_quantity.h. If there are already explicit operators for
+ * the types being multiplied or divided, the compiler will chose
+ * that overload instead. Otherwise it falls back to those, which
+ * give a Quantity for the classes that have a known dimension and
+ * one of these classes for the rest.
  */
-template<int PA, template<int...> class A, int PB, template<int...> class B>
-constexpr auto operator*(Unit<PA,A> a, Unit<PB,B> b)
-{ return UnitsMul{a,b}; }
-
-template<int PA, template<int...> class A, int PB, template<int...> class B>
-constexpr auto operator/(Unit<PA,A> a, Unit<PB,B> b)
-{ return UnitsDiv{a,b}; }
 
 /* These are some of the relations that breaks these classes
  * and results in one of the defined physical types.
@@ -40,6 +40,10 @@ public:
     , m_max{max}
     , m_step{step} {}
 
+    constexpr T min() const { return m_min; }
+    constexpr T max() const { return m_max; }
+    constexpr T step() const { return m_step; }
+
     class Iter
     {
     private:
@@ -43,25 +43,28 @@ public:
     constexpr T& operator()(std::uint8_t index) { return (*this)[index]; }
     constexpr T operator()(std::uint8_t index) const { return (*this)[index]; }
 
-    Str toString() const
+    void appendTo(Str& out) const
     {
-        Str s = "[";
+        out += '[';
         for (std::int8_t i = 0 ; i < N-1 ; i++)
-            s += conv2str(m_data[i]) + ", ";
-        s += conv2str(m_data[N-1]) + "]";
-        return s;
+        {
+            append2str(out, m_data[i]);
+            out += ", ";
+        }
+        append2str(out, m_data[N-1]);
+        out += ']';
     }
 
+    Str toString() const { Str s; appendTo(s); return s; }
+
     friend std::ostream &operator<<(std::ostream &output, const Vector& obj)
     {
-        output << obj.toString();
-        return output;
+        return __Print(output, obj);
     }
 
     friend std::ostream &operator<<(std::ostream &output, const Vector&& obj)
     {
-        output << obj.toString();
-        return output;
+        return __Print(output, obj);
     }
 
     constexpr Vector<Real,N> normalized() const;